@@ -3,67 +3,356 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <charconv>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <climits>
+#include <cstdio>
+#include <mutex>
+#include <condition_variable>
+
+#include "money.h"
+#include "fileio.h"
+#include "parallel_for.h"
 
 using std::ifstream;
 using std::ofstream;
 
+class Employee;
+
+struct EmployeeRecord
+{
+    int id;
+    std::string_view name; // Trỏ vào bộ đệm đầu vào hoặc bộ đệm của parser
+    int age;
+    Money salary;
+    size_t line; // Số thứ tự dòng trong dữ liệu đã đưa vào parser
+};
+
+struct CsvError
+{
+    size_t line;
+    std::string message;
+};
+
+// Parser CSV dạng luồng: đọc từng khối lớn, không tạo chuỗi tạm cho mỗi trường.
+// Tên có dấu phẩy được đặt trong ngoặc kép, dấu " bên trong viết thành "".
+class EmployeeCsvParser
+{
+private:
+    size_t lineNumber = 0;
+    std::deque<std::string> unescapedNames; // deque giữ địa chỉ ổn định cho string_view
+
+    static std::string_view trim(std::string_view field)
+    {
+        while (!field.empty() && (field.front() == ' ' || field.front() == '\t'))
+        {
+            field.remove_prefix(1);
+        }
+        while (!field.empty() && (field.back() == ' ' || field.back() == '\t'))
+        {
+            field.remove_suffix(1);
+        }
+        return field;
+    }
+
+    template <typename T>
+    static bool parseNumber(std::string_view field, T &value)
+    {
+        field = trim(field);
+        auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+        return result.ec == std::errc() && result.ptr == field.data() + field.size() && !field.empty();
+    }
+
+    // Đọc một trường bắt đầu tại pos; pos được đặt sau dấu phẩy kết thúc trường
+    bool nextField(std::string_view line, size_t &pos, std::string_view &field, std::string &error)
+    {
+        if (pos < line.size() && line[pos] == '"')
+        {
+            size_t start = pos + 1;
+            size_t end = start;
+            bool escaped = false;
+            while (true)
+            {
+                end = line.find('"', end);
+                if (end == std::string_view::npos)
+                {
+                    error = "unterminated quoted field";
+                    return false;
+                }
+                if (end + 1 < line.size() && line[end + 1] == '"')
+                {
+                    escaped = true;
+                    end += 2;
+                    continue;
+                }
+                break;
+            }
+            field = line.substr(start, end - start);
+            if (escaped)
+            {
+                std::string name;
+                name.reserve(field.size());
+                for (size_t i = 0; i < field.size(); ++i)
+                {
+                    name += field[i];
+                    if (field[i] == '"')
+                    {
+                        ++i;
+                    }
+                }
+                unescapedNames.push_back(std::move(name));
+                field = unescapedNames.back();
+            }
+            pos = end + 1;
+            if (pos < line.size() && line[pos] != ',')
+            {
+                error = "unexpected character after closing quote";
+                return false;
+            }
+        }
+        else
+        {
+            size_t end = line.find(',', pos);
+            if (end == std::string_view::npos)
+            {
+                end = line.size();
+            }
+            field = line.substr(pos, end - pos);
+            pos = end;
+        }
+        if (pos < line.size())
+        {
+            ++pos; // Bỏ qua dấu phẩy
+        }
+        else
+        {
+            pos = line.size() + 1; // Đánh dấu đã hết dòng
+        }
+        return true;
+    }
+
+public:
+    bool parseLine(std::string_view line, EmployeeRecord &record, std::string &error)
+    {
+        size_t pos = 0;
+        std::string_view fields[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            if (pos > line.size())
+            {
+                error = "expected 4 fields";
+                return false;
+            }
+            if (!nextField(line, pos, fields[i], error))
+            {
+                return false;
+            }
+        }
+        if (pos <= line.size())
+        {
+            error = "too many fields";
+            return false;
+        }
+        if (!parseNumber(fields[0], record.id))
+        {
+            error = "invalid id";
+            return false;
+        }
+        if (!parseNumber(fields[2], record.age))
+        {
+            error = "invalid age";
+            return false;
+        }
+        if (!Money::parse(fields[3], record.salary))
+        {
+            error = "invalid salary";
+            return false;
+        }
+        record.name = fields[1];
+        return true;
+    }
+
+    // Phân tích các dòng hoàn chỉnh trong chunk và trả về số byte đã dùng.
+    // Phần còn lại là dòng dở dang, người gọi ghép với khối tiếp theo.
+    // Khi isLast = true, dòng cuối không có '\n' cũng được phân tích.
+    size_t parse(std::string_view chunk, std::vector<EmployeeRecord> &out, std::vector<CsvError> &errors, bool isLast = false)
+    {
+        size_t pos = 0;
+        std::string error;
+        while (pos < chunk.size())
+        {
+            size_t end = chunk.find('\n', pos);
+            if (end == std::string_view::npos)
+            {
+                if (!isLast)
+                {
+                    break;
+                }
+                end = chunk.size();
+            }
+            std::string_view line = chunk.substr(pos, end - pos);
+            pos = end + 1;
+            ++lineNumber;
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.remove_suffix(1);
+            }
+            if (line.empty())
+            {
+                continue;
+            }
+            EmployeeRecord record;
+            if (parseLine(line, record, error))
+            {
+                record.line = lineNumber;
+                out.push_back(record);
+            }
+            else
+            {
+                errors.push_back({lineNumber, error});
+            }
+        }
+        return std::min(pos, chunk.size());
+    }
+
+    // Gọi sau khi đã dùng xong một lô bản ghi
+    void clearBatch()
+    {
+        unescapedNames.clear();
+    }
+
+    size_t linesRead() const
+    {
+        return lineNumber;
+    }
+};
+
+// Ghi một trường CSV, đặt trong ngoặc kép nếu có dấu phẩy, ngoặc kép hoặc xuống dòng (\n, \r).
+// EmployeeCsvParser đọc theo dòng nên tên có xuống dòng không đọc lại được, nhưng nhờ ngoặc kép
+// phần sau dấu xuống dòng báo lỗi chứ không thành một dòng nhân viên giả.
+void appendCsvField(std::string &out, std::string_view field)
+{
+    if (field.find_first_of(",\"\n\r") == std::string_view::npos)
+    {
+        out += field;
+        return;
+    }
+    out += '"';
+    for (char c : field)
+    {
+        out += c;
+        if (c == '"')
+        {
+            out += '"';
+        }
+    }
+    out += '"';
+}
+
+constexpr Money HOURLY_RATE = Money::of(25000);                 // 1 gio 25k
+constexpr Money MANAGER_ALLOWANCE_PER_MEMBER = Money::of(1000); // Phụ cấp quản lý mỗi nhân viên
+
+enum class EmployeeType : unsigned char
+{
+    Regular,
+    Hourly,
+    Manager
+};
+
 class Employee
 {
 protected:
     int id;
     std::string name;
     int age;
-    double salary;
+    Money salary;
 
 public:
-    Employee(int _id, std::string _name, int _age, double _salary)
+    Employee(int _id, std::string _name, int _age, Money _salary)
         : id(_id), name(_name), age(_age), salary(_salary) {}
 
+    virtual ~Employee() = default;
+
     virtual void displayInfo() const
     {
-        std::cout << "ID: " << id << ", Tên: " << name << ", Tuổi: " << age << ", Lương: " << salary << std::endl;
+        std::cout << "ID: " << id << ", Tên: " << name << ", Tuổi: " << age << ", Lương: " << salary << '\n';
     }
-    virtual double getSalary() const
+    virtual Money getSalary() const
     {
         return salary;
     }
-    void increaseSalary(double amount)
-    {
-        salary += amount;
-    }
-    int getId()
+    int getId() const
     {
         return id;
     }
-    int getAge()
+    int getAge() const
     {
         return age;
     }
-    std::string getName()
+    const std::string &getName() const
     {
         return name;
     }
+    Money getBaseSalary() const
+    {
+        return salary;
+    }
+    virtual EmployeeType getType() const
+    {
+        return EmployeeType::Regular;
+    }
+    virtual int getWorkHours() const
+    {
+        return 0;
+    }
+    virtual int getTeamSize() const
+    {
+        return 0;
+    }
 
     std::string serialize() const
     {
-        return std::to_string(id) + "," + name + "," + std::to_string(age) + "," + std::to_string(salary);
+        std::string line = std::to_string(id) + ",";
+        appendCsvField(line, name);
+        return line + "," + std::to_string(age) + "," + salary.toString();
     }
 
-    static Employee *deserialize(const std::string &data)
+    // Trả về nullptr nếu dòng không hợp lệ
+    static std::unique_ptr<Employee> deserialize(const std::string &data)
     {
-        size_t pos = 0;
-        int id = std::stoi(data.substr(pos, data.find(',', pos) - pos));
-        pos = data.find(',', pos) + 1;
-
-        std::string name = data.substr(pos, data.find(',', pos) - pos);
-        pos = data.find(',', pos) + 1;
-
-        int age = std::stoi(data.substr(pos, data.find(',', pos) - pos));
-        pos = data.find(',', pos) + 1;
+        EmployeeCsvParser parser;
+        EmployeeRecord record;
+        std::string error;
+        if (!parser.parseLine(data, record, error))
+        {
+            return nullptr;
+        }
+        return std::make_unique<Employee>(record.id, std::string(record.name), record.age, record.salary);
+    }
 
-        double salary = std::stod(data.substr(pos));
+private:
+    // Chỉ Department và Company được sửa nhân viên, để chỉ mục và các tổng lương luôn đồng bộ
+    friend class Department;
+    friend class Company;
 
-        return new Employee(id, name, age, salary);
+    void increaseSalary(Money amount)
+    {
+        salary += amount;
     }
 };
 
@@ -74,10 +363,30 @@ private:
 
 public:
     HourlyEmployee(int _id, std::string _name, int _age, int _workHours)
-        : Employee(_id, _name, _age, 0), workHours(_workHours) {}
-    double getSalary() const override
+        : Employee(_id, _name, _age, Money()), workHours(_workHours) {}
+    // Khôi phục từ snapshot: giữ nguyên lương cơ bản đã lưu
+    HourlyEmployee(int _id, std::string _name, int _age, int _workHours, Money _salary)
+        : Employee(_id, _name, _age, _salary), workHours(_workHours) {}
+    Money getSalary() const override
+    {
+        return HOURLY_RATE * workHours;
+    }
+    EmployeeType getType() const override
+    {
+        return EmployeeType::Hourly;
+    }
+    int getWorkHours() const override
+    {
+        return workHours;
+    }
+
+private:
+    friend class Department;
+    friend class Company;
+
+    void setWorkHours(int hours)
     {
-        return workHours * 25000; // 1 gio 25k
+        workHours = hours;
     }
 };
 
@@ -87,189 +396,2039 @@ private:
     int teamSize;
 
 public:
-    Manager(int _id, std::string _name, int _age, double _salary, int _teamSize)
+    Manager(int _id, std::string _name, int _age, Money _salary, int _teamSize)
         : Employee(_id, _name, _age, _salary), teamSize(_teamSize) {}
     void displayInfo() const override
     {
         Employee::displayInfo();
-        std::cout << "Số nhân viên quản lý: " << teamSize << std::endl;
+        std::cout << "Số nhân viên quản lý: " << teamSize << '\n';
+    }
+    Money getSalary() const override
+    {
+        return salary + MANAGER_ALLOWANCE_PER_MEMBER * teamSize;
+    }
+    EmployeeType getType() const override
+    {
+        return EmployeeType::Manager;
+    }
+    int getTeamSize() const override
+    {
+        return teamSize;
     }
-    double getSalary() const override
+
+private:
+    friend class Department;
+    friend class Company;
+
+    void setTeamSize(int size)
     {
-        return salary + (teamSize * 1000); // Phụ cấp quản lý
+        teamSize = size;
     }
 };
 
-class Department
+// Nơi nhận dữ liệu báo cáo: file, pipe, std::ostream hoặc bộ nhớ
+class ReportSink
+{
+public:
+    virtual void write(const char *data, size_t size) = 0;
+    virtual void flush() {}
+    virtual ~ReportSink() = default;
+};
+
+class StreamSink : public ReportSink
 {
 private:
-    std::vector<Employee *> employees;
+    std::ostream &stream;
 
 public:
-    void addEmployee(Employee *emp)
+    explicit StreamSink(std::ostream &_stream) : stream(_stream) {}
+    void write(const char *data, size_t size) override
     {
-        employees.push_back(emp);
+        stream.write(data, static_cast<std::streamsize>(size));
+    }
+    void flush() override
+    {
+        stream.flush();
     }
+};
 
-    void displayAllEmployees() const {
-        for (const auto& emp : employees) {
-            emp->displayInfo();
-        }
+// Ghi vào FILE* có sẵn, ví dụ stdout hoặc pipe từ popen
+class FileSink : public ReportSink
+{
+private:
+    FILE *file;
+
+public:
+    explicit FileSink(FILE *_file) : file(_file) {}
+    void write(const char *data, size_t size) override
+    {
+        std::fwrite(data, 1, size, file);
+    }
+    void flush() override
+    {
+        std::fflush(file);
+    }
+};
+
+class StringSink : public ReportSink
+{
+private:
+    std::string data;
+
+public:
+    void write(const char *chunk, size_t size) override
+    {
+        data.append(chunk, size);
+    }
+    const std::string &str() const
+    {
+        return data;
     }
+};
 
-    Employee *findEmployeeById(int id) const
+// Gom dữ liệu vào bộ đệm và chỉ ghi ra sink khi đầy, thay vì flush mỗi dòng.
+// Với backgroundWriter = true, việc ghi chạy trên một luồng riêng; các bộ đệm
+// đã ghi xong được dùng lại nên không cấp phát thêm sau vài khối đầu.
+class ReportWriter
+{
+private:
+    static const size_t FLUSH_THRESHOLD = 1 << 16;
+    static const size_t MAX_QUEUED = 4;
+
+    ReportSink &sink;
+    std::string buffer;
+    bool background;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> queue;
+    std::vector<std::string> spare;
+    bool writing = false;
+    bool stopping = false;
+
+    void run()
     {
-        for (const auto &emp : employees)
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
         {
-            if (emp->getId() == id)
+            changed.wait(lock, [this]
+                         { return stopping || !queue.empty(); });
+            if (queue.empty())
             {
-                return emp;
+                return;
             }
+            std::string block = std::move(queue.front());
+            queue.pop_front();
+            writing = true;
+            lock.unlock();
+            sink.write(block.data(), block.size());
+            block.clear();
+            lock.lock();
+            writing = false;
+            spare.push_back(std::move(block));
+            changed.notify_all();
         }
-        return nullptr; // Nếu không tìm thấy
     }
 
-    Employee *findEmployeeByName(const std::string &name) const
+    void handOff()
     {
-        for (const auto &emp : employees)
+        if (buffer.empty())
         {
-            if (emp->getName() == name)
-            {
-                return emp;
-            }
+            return;
+        }
+        if (!background)
+        {
+            sink.write(buffer.data(), buffer.size());
+            buffer.clear();
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]
+                     { return queue.size() < MAX_QUEUED; });
+        queue.push_back(std::move(buffer));
+        buffer.clear();
+        if (!spare.empty())
+        {
+            buffer = std::move(spare.back());
+            spare.pop_back();
+        }
+        changed.notify_all();
+    }
+
+public:
+    explicit ReportWriter(ReportSink &_sink, bool backgroundWriter = false)
+        : sink(_sink), background(backgroundWriter)
+    {
+        buffer.reserve(FLUSH_THRESHOLD * 2);
+        if (background)
+        {
+            thread = std::thread(&ReportWriter::run, this);
         }
-        return nullptr; // Nếu không tìm thấy
     }
 
-    void sortByAge()
+    ReportWriter(const ReportWriter &) = delete;
+    ReportWriter &operator=(const ReportWriter &) = delete;
+
+    // Bộ đệm để định dạng dòng tiếp theo; gọi endRow() sau khi ghi xong dòng
+    std::string &out()
     {
-        sort(employees.begin(), employees.end(), [](Employee *a, Employee *b)
-             { return a->getAge() < b->getAge(); });
+        return buffer;
     }
 
-    void sortBySalary()
+    void endRow()
     {
-        sort(employees.begin(), employees.end(), [](Employee *a, Employee *b)
-             { return a->getSalary() < b->getSalary(); });
+        if (buffer.size() >= FLUSH_THRESHOLD)
+        {
+            handOff();
+        }
     }
-    std::vector<Employee*>& getEmployees() {
-    return employees;
+
+    // Đợi mọi dữ liệu đã được ghi ra sink
+    void flush()
+    {
+        handOff();
+        if (background)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this]
+                         { return queue.empty() && !writing; });
+        }
+        sink.flush();
     }
 
-    ~Department()
+    ~ReportWriter()
     {
-        for (auto emp : employees)
+        flush();
+        if (background)
         {
-            delete emp;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            changed.notify_all();
+            thread.join();
         }
     }
 };
 
-class Company
+enum class ReportFormat
+{
+    Table,
+    Csv,
+    Json
+};
+
+// Định dạng nhân viên thành bảng, CSV hoặc JSON bằng std::to_chars
+class EmployeeReport
 {
 private:
-    std::vector<Employee *> employees;
+    ReportWriter writer;
+    ReportFormat format;
+    std::string rowSeparator;
+    size_t rows = 0;
+    bool finished = false;
 
-public:
-    void addEmployee(Employee *emp)
+    static void appendNumber(std::string &out, int value)
     {
-        employees.push_back(emp);
+        char text[16];
+        auto result = std::to_chars(text, text + sizeof text, value);
+        out.append(text, result.ptr);
     }
-    void displayAllEmployees() const
+
+    static void appendNumber(std::string &out, Money value)
     {
-        for (const auto &emp : employees)
+        char text[32];
+        out.append(text, value.format(text, text + sizeof text));
+    }
+
+    static void appendJsonString(std::string &out, const std::string &text)
+    {
+        static const char HEX[] = "0123456789abcdef";
+        out += '"';
+        for (unsigned char c : text)
         {
-            emp->displayInfo();
-            std::cout << "------------------------" << std::endl;
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += static_cast<char>(c);
+            }
+            else if (c < 0x20)
+            {
+                out += "\\u00";
+                out += HEX[c >> 4];
+                out += HEX[c & 0xF];
+            }
+            else
+            {
+                out += static_cast<char>(c);
+            }
         }
+        out += '"';
     }
-    double getTotalSalary() const
+
+    static const char *typeName(EmployeeType type)
     {
-        double total = 0;
-        for (const auto &emp : employees)
+        switch (type)
         {
-            total += emp->getSalary();
+        case EmployeeType::Hourly:
+            return "hourly";
+        case EmployeeType::Manager:
+            return "manager";
+        default:
+            return "employee";
         }
-        return total;
     }
-    ~Company()
+
+public:
+    EmployeeReport(ReportSink &sink, ReportFormat _format, bool backgroundWriter = false)
+        : writer(sink, backgroundWriter), format(_format)
     {
-        for (auto emp : employees)
+        if (format == ReportFormat::Csv)
         {
-            delete emp;
+            writer.out() += "id,name,age,type,salary,pay,workHours,teamSize\n";
+        }
+        else if (format == ReportFormat::Json)
+        {
+            writer.out() += '[';
         }
     }
-};
 
-void saveToFile(const std::vector<Employee *> &employees, const std::string &filename)
-{
-    ofstream outFile(filename);
-    if (!outFile)
+    EmployeeReport(const EmployeeReport &) = delete;
+    EmployeeReport &operator=(const EmployeeReport &) = delete;
+
+    // Chỉ dùng cho dạng bảng, ghi sau mỗi nhân viên
+    void setRowSeparator(const std::string &separator)
     {
-        std::cout << "Error opening file for writing." << std::endl;
-        return;
+        rowSeparator = separator;
     }
 
-    for (const auto &emp : employees)
+    void add(const Employee &emp)
     {
-        outFile << emp->serialize() << std::endl;
+        std::string &out = writer.out();
+        switch (format)
+        {
+        case ReportFormat::Table:
+            out += "ID: ";
+            appendNumber(out, emp.getId());
+            out += ", Tên: ";
+            out += emp.getName();
+            out += ", Tuổi: ";
+            appendNumber(out, emp.getAge());
+            out += ", Lương: ";
+            appendNumber(out, emp.getBaseSalary());
+            out += '\n';
+            if (emp.getType() == EmployeeType::Manager)
+            {
+                out += "Số nhân viên quản lý: ";
+                appendNumber(out, emp.getTeamSize());
+                out += '\n';
+            }
+            out += rowSeparator;
+            break;
+        case ReportFormat::Csv:
+            appendNumber(out, emp.getId());
+            out += ',';
+            appendCsvField(out, emp.getName());
+            out += ',';
+            appendNumber(out, emp.getAge());
+            out += ',';
+            out += typeName(emp.getType());
+            out += ',';
+            appendNumber(out, emp.getBaseSalary());
+            out += ',';
+            appendNumber(out, emp.getSalary());
+            out += ',';
+            appendNumber(out, emp.getWorkHours());
+            out += ',';
+            appendNumber(out, emp.getTeamSize());
+            out += '\n';
+            break;
+        case ReportFormat::Json:
+            out += rows == 0 ? "\n" : ",\n";
+            out += "{\"id\":";
+            appendNumber(out, emp.getId());
+            out += ",\"name\":";
+            appendJsonString(out, emp.getName());
+            out += ",\"age\":";
+            appendNumber(out, emp.getAge());
+            out += ",\"type\":\"";
+            out += typeName(emp.getType());
+            out += "\",\"salary\":";
+            appendNumber(out, emp.getBaseSalary());
+            out += ",\"pay\":";
+            appendNumber(out, emp.getSalary());
+            out += ",\"workHours\":";
+            appendNumber(out, emp.getWorkHours());
+            out += ",\"teamSize\":";
+            appendNumber(out, emp.getTeamSize());
+            out += '}';
+            break;
+        }
+        ++rows;
+        writer.endRow();
     }
-    outFile.close();
-}
 
-void loadFromFile(std::vector<Employee *> &employees, const std::string &filename)
-{
-    ifstream inFile(filename);
-    if (!inFile)
+    template <typename EmployeePointer>
+    void addAll(const std::vector<EmployeePointer> &employees)
     {
-        std::cout << "Error opening file for reading." << std::endl;
-        return;
+        for (const auto &emp : employees)
+        {
+            add(*emp);
+        }
     }
 
-    std::string line;
-    while (getline(inFile, line))
+    // Đóng báo cáo (thêm "]" cho JSON) và đợi ghi xong
+    void finish()
     {
-        if (!line.empty())
+        if (finished)
+        {
+            return;
+        }
+        finished = true;
+        if (format == ReportFormat::Json)
         {
-            employees.push_back(Employee::deserialize(line));
+            writer.out() += "\n]\n";
         }
+        writer.flush();
     }
-    inFile.close();
-}
 
-int main()
+    ~EmployeeReport()
+    {
+        finish();
+    }
+};
+
+// Lưu nhân viên theo cột (struct-of-arrays) để tính tổng lương không cần gọi hàm ảo.
+// Cột nào không dùng cho loại nhân viên đó thì bằng 0, nên mọi loại đều có chung
+// công thức: base + teamSize * phụ cấp + workHours * lương giờ.
+class EmployeeColumns
 {
-    Company myCompany;
-    myCompany.addEmployee(new Employee(1, "Nguyễn Văn A", 30, 10000000));
-    myCompany.addEmployee(new Employee(2, "Trần Thị B", 25, 8000000));
-    myCompany.addEmployee(new Manager(3, "Lê Văn C", 40, 20000000, 5));
-    std::cout << "Thông tin tất cả nhân viên:" << std::endl;
-    myCompany.displayAllEmployees();
+private:
+    std::vector<int> ids;
+    std::vector<int> ages;
+    std::vector<Money> baseSalaries;
+    std::vector<int> workHours;
+    std::vector<int> teamSizes;
+    std::vector<EmployeeType> types;
+
+    Money payAt(size_t i) const
+    {
+        return baseSalaries[i] + MANAGER_ALLOWANCE_PER_MEMBER * teamSizes[i] + HOURLY_RATE * workHours[i];
+    }
+
+public:
+    static EmployeeColumns fromEmployees(const std::vector<Employee *> &employees)
+    {
+        EmployeeColumns columns;
+        columns.reserve(employees.size());
+        for (const auto &emp : employees)
+        {
+            columns.append(*emp);
+        }
+        return columns;
+    }
+
+    void reserve(size_t n)
+    {
+        ids.reserve(n);
+        ages.reserve(n);
+        baseSalaries.reserve(n);
+        workHours.reserve(n);
+        teamSizes.reserve(n);
+        types.reserve(n);
+    }
+
+    void append(const Employee &emp)
+    {
+        ids.push_back(0);
+        ages.push_back(0);
+        baseSalaries.push_back(Money());
+        workHours.push_back(0);
+        teamSizes.push_back(0);
+        types.push_back(EmployeeType::Regular);
+        set(ids.size() - 1, emp);
+    }
+
+    // Cập nhật lại một dòng sau khi đối tượng nhân viên thay đổi
+    void set(size_t row, const Employee &emp)
+    {
+        ids[row] = emp.getId();
+        ages[row] = emp.getAge();
+        types[row] = emp.getType();
+        // Lương cơ bản của nhân viên theo giờ không được tính vào lương thực nhận
+        baseSalaries[row] = types[row] == EmployeeType::Hourly ? Money() : emp.getBaseSalary();
+        workHours[row] = emp.getWorkHours();
+        teamSizes[row] = emp.getTeamSize();
+    }
+
+    // Xoá một dòng bằng cách chuyển dòng cuối vào vị trí đó
+    void swapRemove(size_t row)
+    {
+        const size_t last = size() - 1;
+        ids[row] = ids[last];
+        ages[row] = ages[last];
+        baseSalaries[row] = baseSalaries[last];
+        workHours[row] = workHours[last];
+        teamSizes[row] = teamSizes[last];
+        types[row] = types[last];
+        ids.pop_back();
+        ages.pop_back();
+        baseSalaries.pop_back();
+        workHours.pop_back();
+        teamSizes.pop_back();
+        types.pop_back();
+    }
+
+    size_t size() const
+    {
+        return ids.size();
+    }
+
+    int idAt(size_t row) const
+    {
+        return ids[row];
+    }
+
+    int ageAt(size_t row) const
+    {
+        return ages[row];
+    }
+
+    Money baseSalaryAt(size_t row) const
+    {
+        return baseSalaries[row];
+    }
+
+    int workHoursAt(size_t row) const
+    {
+        return workHours[row];
+    }
+
+    int teamSizeAt(size_t row) const
+    {
+        return teamSizes[row];
+    }
+
+    EmployeeType typeAt(size_t row) const
+    {
+        return types[row];
+    }
+
+    Money salaryAt(size_t row) const
+    {
+        return payAt(row);
+    }
+
+    // Cộng số nguyên nên tổng chính xác và không phụ thuộc thứ tự cộng;
+    // trình biên dịch được tự do vector hoá vòng lặp
+    Money totalSalary() const
+    {
+        Money total;
+        for (size_t i = 0; i < size(); ++i)
+        {
+            total += payAt(i);
+        }
+        return total;
+    }
+
+    Money averageSalary() const
+    {
+        return size() == 0 ? Money() : totalSalary() / static_cast<int64_t>(size());
+    }
+
+    Money minSalary() const
+    {
+        Money result = size() == 0 ? Money() : payAt(0);
+        for (size_t i = 1; i < size(); ++i)
+        {
+            result = std::min(result, payAt(i));
+        }
+        return result;
+    }
+
+    Money maxSalary() const
+    {
+        Money result = size() == 0 ? Money() : payAt(0);
+        for (size_t i = 1; i < size(); ++i)
+        {
+            result = std::max(result, payAt(i));
+        }
+        return result;
+    }
+
+    // Tổng lương theo từng loại, đánh chỉ số bằng EmployeeType
+    std::array<Money, 3> salaryByType() const
+    {
+        Money regular, hourly, manager;
+        for (size_t i = 0; i < size(); ++i)
+        {
+            const Money pay = payAt(i);
+            regular += types[i] == EmployeeType::Regular ? pay : Money();
+            hourly += types[i] == EmployeeType::Hourly ? pay : Money();
+            manager += types[i] == EmployeeType::Manager ? pay : Money();
+        }
+        return {regular, hourly, manager};
+    }
+
+    Money totalSalaryOf(EmployeeType type) const
+    {
+        return salaryByType()[static_cast<size_t>(type)];
+    }
+};
+
+// Cấp phát đối tượng theo khối lớn thay vì new từng đối tượng.
+// Ô đã huỷ được đưa vào danh sách trống để dùng lại; khi pool bị huỷ,
+// các đối tượng còn sống được gọi hàm huỷ rồi giải phóng cả khối một lần.
+// Chỉ khi T có hàm huỷ tầm thường thì huỷ pool mới là O(số khối); các loại nhân viên giữ tên trong
+// std::string trên heap nên vẫn phải huỷ từng đối tượng để trả bộ nhớ tên.
+template <typename T>
+class ObjectPool
+{
+private:
+    struct Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        Slot *nextFree;
+        bool live;
+    };
+
+    struct Block
+    {
+        std::unique_ptr<Slot[]> slots;
+        size_t used;
+    };
+
+    static const size_t BLOCK_SIZE = 1024;
+    std::vector<Block> blocks;
+    Slot *freeList = nullptr;
+    size_t liveCount = 0;
+
+    void release()
+    {
+        if constexpr (!std::is_trivially_destructible<T>::value)
+        {
+            for (auto &block : blocks)
+            {
+                for (size_t i = 0; i < block.used; ++i)
+                {
+                    if (block.slots[i].live)
+                    {
+                        reinterpret_cast<T *>(block.slots[i].storage)->~T();
+                    }
+                }
+            }
+        }
+        blocks.clear();
+        freeList = nullptr;
+        liveCount = 0;
+    }
+
+    Slot *takeSlot()
+    {
+        if (freeList)
+        {
+            Slot *slot = freeList;
+            freeList = slot->nextFree;
+            return slot;
+        }
+        if (blocks.empty() || blocks.back().used == BLOCK_SIZE)
+        {
+            blocks.push_back({std::unique_ptr<Slot[]>(new Slot[BLOCK_SIZE]), 0});
+        }
+        return &blocks.back().slots[blocks.back().used++];
+    }
+
+public:
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    ObjectPool(ObjectPool &&other) noexcept
+        : blocks(std::move(other.blocks)), freeList(other.freeList), liveCount(other.liveCount)
+    {
+        other.blocks.clear();
+        other.freeList = nullptr;
+        other.liveCount = 0;
+    }
+
+    ObjectPool &operator=(ObjectPool &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            blocks = std::move(other.blocks);
+            freeList = other.freeList;
+            liveCount = other.liveCount;
+            other.blocks.clear();
+            other.freeList = nullptr;
+            other.liveCount = 0;
+        }
+        return *this;
+    }
+
+    template <typename... Args>
+    T *create(Args &&...args)
+    {
+        Slot *slot = takeSlot();
+        slot->live = false;
+        try
+        {
+            new (slot->storage) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            slot->nextFree = freeList;
+            freeList = slot;
+            throw;
+        }
+        slot->live = true;
+        ++liveCount;
+        return reinterpret_cast<T *>(slot->storage);
+    }
+
+    void destroy(T *object)
+    {
+        Slot *slot = reinterpret_cast<Slot *>(object); // storage là thành viên đầu tiên của Slot
+        object->~T();
+        slot->live = false;
+        slot->nextFree = freeList;
+        freeList = slot;
+        --liveCount;
+    }
+
+    size_t size() const
+    {
+        return liveCount;
+    }
+
+    ~ObjectPool()
+    {
+        release();
+    }
+};
+
+// Mỗi loại nhân viên có pool riêng nên các đối tượng cùng loại nằm liền nhau
+class EmployeeArena
+{
+private:
+    ObjectPool<Employee> employees;
+    ObjectPool<HourlyEmployee> hourlyEmployees;
+    ObjectPool<Manager> managers;
+
+    template <typename T>
+    ObjectPool<T> &poolFor()
+    {
+        if constexpr (std::is_same<T, HourlyEmployee>::value)
+        {
+            return hourlyEmployees;
+        }
+        else if constexpr (std::is_same<T, Manager>::value)
+        {
+            return managers;
+        }
+        else
+        {
+            static_assert(std::is_same<T, Employee>::value, "EmployeeArena has no pool for this type");
+            return employees;
+        }
+    }
+
+public:
+    template <typename T, typename... Args>
+    T *create(Args &&...args)
+    {
+        return poolFor<T>().create(std::forward<Args>(args)...);
+    }
+
+    void destroy(Employee *emp)
+    {
+        switch (emp->getType())
+        {
+        case EmployeeType::Hourly:
+            hourlyEmployees.destroy(static_cast<HourlyEmployee *>(emp));
+            break;
+        case EmployeeType::Manager:
+            managers.destroy(static_cast<Manager *>(emp));
+            break;
+        default:
+            employees.destroy(emp);
+        }
+    }
+
+    size_t size() const
+    {
+        return employees.size() + hourlyEmployees.size() + managers.size();
+    }
+};
+
+// Đổi khoá sang số nguyên không dấu có cùng thứ tự để sắp xếp theo cơ số
+inline uint64_t radixKey(int value)
+{
+    return static_cast<uint32_t>(value) ^ 0x80000000u;
+}
+
+inline uint64_t radixKey(Money value)
+{
+    return static_cast<uint64_t>(value.units()) ^ (1ull << 63);
+}
+
+// Radix sort LSD ổn định, 8 bit mỗi lượt; trả về hoán vị chỉ số thay vì di chuyển dữ liệu.
+// Lượt nào mà mọi khoá có cùng byte thì bỏ qua, nên khoá int chỉ tốn 4 lượt.
+inline std::vector<size_t> radixSortPermutation(const std::vector<uint64_t> &keys)
+{
+    const size_t n = keys.size();
+    std::vector<size_t> order(n), buffer(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        order[i] = i;
+    }
+
+    std::vector<std::array<size_t, 256>> counts(8);
+    for (auto &count : counts)
+    {
+        count.fill(0);
+    }
+    for (uint64_t key : keys)
+    {
+        for (int pass = 0; pass < 8; ++pass)
+        {
+            ++counts[pass][(key >> (pass * 8)) & 0xFF];
+        }
+    }
+
+    for (int pass = 0; pass < 8; ++pass)
+    {
+        auto &count = counts[pass];
+        if (n == 0 || count[(keys[0] >> (pass * 8)) & 0xFF] == n)
+        {
+            continue;
+        }
+        size_t offset = 0;
+        for (auto &c : count)
+        {
+            size_t bucketSize = c;
+            c = offset;
+            offset += bucketSize;
+        }
+        for (size_t idx : order)
+        {
+            buffer[count[(keys[idx] >> (pass * 8)) & 0xFF]++] = idx;
+        }
+        order.swap(buffer);
+    }
+    return order;
+}
+
+class Department
+{
+private:
+    EmployeeArena arena;
+    std::vector<Employee *> employees;
+    // Chỉ mục tra cứu, luôn đồng bộ với employees. idIndex lưu vị trí trong employees để xoá
+    // không phải tìm tuyến tính; tuổi và lương có khoá phụ là id nên xoá một mục là O(log n)
+    // kể cả khi nhiều người trùng tuổi hay trùng lương.
+    std::unordered_map<int, size_t> idIndex;
+    std::unordered_multimap<std::string, Employee *> nameIndex;
+    std::map<std::pair<int, int>, Employee *> ageIndex;
+    std::map<std::pair<Money, int>, Employee *> salaryIndex;
+
+    template <typename Index, typename Key>
+    static void eraseEntry(Index &index, const Key &key, Employee *emp)
+    {
+        auto range = index.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == emp)
+            {
+                index.erase(it);
+                return;
+            }
+        }
+    }
+
+    void indexEmployee(size_t row)
+    {
+        Employee *emp = employees[row];
+        idIndex.emplace(emp->getId(), row);
+        nameIndex.emplace(emp->getName(), emp);
+        ageIndex.emplace(std::make_pair(emp->getAge(), emp->getId()), emp);
+        salaryIndex.emplace(std::make_pair(emp->getSalary(), emp->getId()), emp);
+    }
+
+    // Sửa một nhân viên rồi đưa lại vào chỉ mục lương; id, tên và tuổi không đổi sau khi tạo
+    template <typename Mutation>
+    bool update(int id, Mutation mutate)
+    {
+        auto found = idIndex.find(id);
+        if (found == idIndex.end())
+        {
+            return false;
+        }
+        Employee *emp = employees[found->second];
+        salaryIndex.erase(std::make_pair(emp->getSalary(), emp->getId()));
+        mutate(emp);
+        salaryIndex.emplace(std::make_pair(emp->getSalary(), emp->getId()), emp);
+        return true;
+    }
+
+    void unindexEmployee(Employee *emp)
+    {
+        idIndex.erase(emp->getId());
+        eraseEntry(nameIndex, emp->getName(), emp);
+        ageIndex.erase(std::make_pair(emp->getAge(), emp->getId()));
+        salaryIndex.erase(std::make_pair(emp->getSalary(), emp->getId()));
+    }
+
+    // Các mục có khoá chính trong khoảng đóng [low, high], theo thứ tự khoá chính rồi id
+    template <typename Index, typename Key>
+    static std::vector<const Employee *> collectRange(const Index &index, const Key &low, const Key &high)
+    {
+        std::vector<const Employee *> result;
+        for (auto it = index.lower_bound(std::make_pair(low, INT_MIN)); it != index.end() && !(high < it->first.first); ++it)
+        {
+            result.push_back(it->second);
+        }
+        return result;
+    }
+
+public:
+    Department() = default;
+    Department(const Department &) = delete;
+    Department &operator=(const Department &) = delete;
+    Department(Department &&) = default;
+    Department &operator=(Department &&) = default;
+
+    // Tạo nhân viên trong arena của Department; trả về nullptr nếu id đã tồn tại
+    template <typename T, typename... Args>
+    T *emplaceEmployee(Args &&...args)
+    {
+        T *emp = arena.create<T>(std::forward<Args>(args)...);
+        if (idIndex.count(emp->getId()))
+        {
+            arena.destroy(emp);
+            return nullptr;
+        }
+        employees.push_back(emp);
+        indexEmployee(employees.size() - 1);
+        return emp;
+    }
+
+    // O(1) trên employees: nhân viên cuối được chuyển vào chỗ trống, nên thứ tự chỉ đổi ở vị trí đó
+    bool removeEmployee(int id)
+    {
+        auto found = idIndex.find(id);
+        if (found == idIndex.end())
+        {
+            return false;
+        }
+        const size_t row = found->second;
+        Employee *emp = employees[row];
+        unindexEmployee(emp);
+        if (row != employees.size() - 1)
+        {
+            employees[row] = employees.back();
+            idIndex[employees[row]->getId()] = row;
+        }
+        employees.pop_back();
+        arena.destroy(emp);
+        return true;
+    }
+
+    // Mọi thay đổi nhân viên đi qua đây để chỉ mục lương không bị lệch
+    bool increaseSalary(int id, Money amount)
+    {
+        return update(id, [amount](Employee *emp)
+                      { emp->increaseSalary(amount); });
+    }
+
+    // false nếu không có id hoặc nhân viên không phải loại theo giờ
+    bool setWorkHours(int id, int hours)
+    {
+        const Employee *emp = findEmployeeById(id);
+        if (!emp || emp->getType() != EmployeeType::Hourly)
+        {
+            return false;
+        }
+        return update(id, [hours](Employee *target)
+                      { static_cast<HourlyEmployee *>(target)->setWorkHours(hours); });
+    }
+
+    // false nếu không có id hoặc nhân viên không phải Manager
+    bool setTeamSize(int id, int size)
+    {
+        const Employee *emp = findEmployeeById(id);
+        if (!emp || emp->getType() != EmployeeType::Manager)
+        {
+            return false;
+        }
+        return update(id, [size](Employee *target)
+                      { static_cast<Manager *>(target)->setTeamSize(size); });
+    }
+
+    void displayAllEmployees() const {
+        writeReport(std::cout, ReportFormat::Table);
+    }
+
+    // In một danh sách con hoặc đã sắp xếp (ví dụ từ sortedByAge) theo cùng định dạng bảng
+    void displayEmployees(const std::vector<const Employee *> &view) const
+    {
+        StreamSink sink(std::cout);
+        EmployeeReport report(sink, ReportFormat::Table);
+        report.addAll(view);
+    }
+
+    void writeReport(std::ostream &stream, ReportFormat format, bool backgroundWriter = false) const
+    {
+        StreamSink sink(stream);
+        EmployeeReport report(sink, format, backgroundWriter);
+        report.addAll(employees);
+    }
+
+    const Employee *findEmployeeById(int id) const
+    {
+        auto found = idIndex.find(id);
+        return found != idIndex.end() ? employees[found->second] : nullptr; // Nếu không tìm thấy
+    }
+
+    // Khi trùng tên, trả về người có id nhỏ nhất để kết quả không phụ thuộc thứ tự trong chỉ mục
+    const Employee *findEmployeeByName(const std::string &name) const
+    {
+        const Employee *result = nullptr; // Nếu không tìm thấy
+        auto range = nameIndex.equal_range(name);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (!result || it->second->getId() < result->getId())
+            {
+                result = it->second;
+            }
+        }
+        return result;
+    }
+
+    // Mọi người trùng tên, theo thứ tự id tăng dần
+    std::vector<const Employee *> findEmployeesByName(const std::string &name) const
+    {
+        std::vector<const Employee *> result;
+        auto range = nameIndex.equal_range(name);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            result.push_back(it->second);
+        }
+        std::sort(result.begin(), result.end(), [](const Employee *a, const Employee *b)
+                  { return a->getId() < b->getId(); });
+        return result;
+    }
+
+    // Khoảng đóng [minAge, maxAge], kết quả theo thứ tự tuổi tăng dần
+    std::vector<const Employee *> findEmployeesByAge(int minAge, int maxAge) const
+    {
+        return collectRange(ageIndex, minAge, maxAge);
+    }
+
+    std::vector<const Employee *> findEmployeesBySalary(Money minSalary, Money maxSalary) const
+    {
+        return collectRange(salaryIndex, minSalary, maxSalary);
+    }
+
+    // Danh sách đã sắp xếp, không thay đổi thứ tự của employees.
+    // Khoá được lấy một lần cho mỗi nhân viên, không gọi hàm ảo khi so sánh.
+    std::vector<const Employee *> sortedByAge() const
+    {
+        std::vector<uint64_t> keys(employees.size());
+        for (size_t i = 0; i < employees.size(); ++i)
+        {
+            keys[i] = radixKey(employees[i]->getAge());
+        }
+        return permuted(radixSortPermutation(keys));
+    }
+
+    std::vector<const Employee *> sortedBySalary() const
+    {
+        std::vector<uint64_t> keys(employees.size());
+        for (size_t i = 0; i < employees.size(); ++i)
+        {
+            keys[i] = radixKey(employees[i]->getSalary());
+        }
+        return permuted(radixSortPermutation(keys));
+    }
+
+    std::vector<const Employee *> permuted(const std::vector<size_t> &order) const
+    {
+        std::vector<const Employee *> view(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            view[i] = employees[order[i]];
+        }
+        return view;
+    }
+
+    const std::vector<Employee*>& getEmployees() const {
+    return employees;
+    }
+};
+
+class Company
+{
+private:
+    EmployeeArena arena;
+    std::vector<Employee *> employees;
+    EmployeeColumns columns;
+    std::unordered_map<int, size_t> rows; // id -> vị trí trong employees/columns
+
+    // Tổng lương được cập nhật dần, không tính lại từ đầu; cộng trừ số nguyên nên không bị trôi
+    Money total;
+    std::array<Money, 3> totalByType;
+    std::array<size_t, 3> countByType = {0, 0, 0};
+    bool verifyTotals = false;
+    size_t totalMismatches = 0; // Số lần chế độ kiểm tra thấy tổng bị lệch
+
+    // Cộng (sign > 0) hoặc trừ lương của dòng row vào các tổng bằng phép có kiểm tra tràn;
+    // trả về false và giữ nguyên các tổng nếu kết quả vượt khoảng của Money
+    bool account(size_t row, int sign)
+    {
+        const Money pay = columns.salaryAt(row);
+        const size_t type = static_cast<size_t>(columns.typeAt(row));
+        Money newTotal;
+        Money newTypeTotal;
+        const bool fits = sign > 0
+                              ? Money::add(total, pay, newTotal) && Money::add(totalByType[type], pay, newTypeTotal)
+                              : Money::subtract(total, pay, newTotal) && Money::subtract(totalByType[type], pay, newTypeTotal);
+        if (!fits)
+        {
+            return false;
+        }
+        total = newTotal;
+        totalByType[type] = newTypeTotal;
+        if (sign > 0)
+        {
+            ++countByType[type];
+        }
+        else
+        {
+            --countByType[type];
+        }
+        return true;
+    }
+
+    // Sửa một nhân viên rồi cập nhật các tổng theo chênh lệch lương. Nếu tổng mới sẽ tràn thì trả
+    // nhân viên về trạng thái cũ và trả về false, như Bank từ chối giao dịch làm tràn số dư
+    template <typename Mutation>
+    bool update(int id, Mutation mutate)
+    {
+        auto found = rows.find(id);
+        if (found == rows.end())
+        {
+            return false;
+        }
+        const size_t row = found->second;
+        Employee *emp = employees[row];
+        const Money oldSalary = emp->salary;
+        const int oldWorkHours = emp->getWorkHours();
+        const int oldTeamSize = emp->getTeamSize();
+        if (!account(row, -1))
+        {
+            return false;
+        }
+        mutate(emp);
+        columns.set(row, *emp);
+        if (!account(row, +1))
+        {
+            emp->salary = oldSalary;
+            if (emp->getType() == EmployeeType::Hourly)
+            {
+                static_cast<HourlyEmployee *>(emp)->setWorkHours(oldWorkHours);
+            }
+            else if (emp->getType() == EmployeeType::Manager)
+            {
+                static_cast<Manager *>(emp)->setTeamSize(oldTeamSize);
+            }
+            columns.set(row, *emp);
+            account(row, +1); // Cộng lại đúng phần vừa trừ nên không thể tràn
+            return false;
+        }
+        checkTotals();
+        return true;
+    }
+
+    void checkTotals()
+    {
+        if (verifyTotals && !totalsMatchRecompute())
+        {
+            ++totalMismatches;
+            recomputeTotals();
+        }
+    }
+
+    void recomputeTotals()
+    {
+        total = Money();
+        totalByType = {};
+        countByType = {0, 0, 0};
+        // Mọi thay đổi đều đã qua account có kiểm tra nên tổng đúng luôn nằm trong khoảng của Money
+        for (size_t row = 0; row < columns.size(); ++row)
+        {
+            account(row, +1);
+        }
+    }
+
+public:
+    Company() = default;
+    Company(const Company &) = delete;
+    Company &operator=(const Company &) = delete;
+    Company(Company &&) = default;
+    Company &operator=(Company &&) = default;
+
+    // Trả về nullptr nếu id đã tồn tại hoặc tổng lương sẽ tràn
+    template <typename T, typename... Args>
+    T *emplaceEmployee(Args &&...args)
+    {
+        T *emp = arena.create<T>(std::forward<Args>(args)...);
+        if (!rows.emplace(emp->getId(), employees.size()).second)
+        {
+            arena.destroy(emp);
+            return nullptr;
+        }
+        employees.push_back(emp);
+        columns.append(*emp);
+        if (!account(columns.size() - 1, +1))
+        {
+            columns.swapRemove(columns.size() - 1);
+            employees.pop_back();
+            rows.erase(emp->getId());
+            arena.destroy(emp);
+            return nullptr;
+        }
+        checkTotals();
+        return emp;
+    }
+
+    // Trả về false nếu không có id, hoặc bỏ lương này ra làm tổng tràn (lương âm); khi đó giữ nhân viên
+    bool removeEmployee(int id)
+    {
+        auto found = rows.find(id);
+        if (found == rows.end())
+        {
+            return false;
+        }
+        const size_t row = found->second;
+        if (!account(row, -1))
+        {
+            return false;
+        }
+        arena.destroy(employees[row]);
+        rows.erase(found);
+        if (row != employees.size() - 1)
+        {
+            employees[row] = employees.back();
+            rows[employees[row]->getId()] = row;
+        }
+        employees.pop_back();
+        columns.swapRemove(row);
+        checkTotals();
+        return true;
+    }
+
+    // Các hàm sửa trả về false nếu không có nhân viên phù hợp hoặc tổng lương sẽ tràn (không đổi gì)
+    bool increaseSalary(int id, Money amount)
+    {
+        return update(id, [amount](Employee *emp)
+                      { emp->increaseSalary(amount); });
+    }
+
+    bool setWorkHours(int id, int hours)
+    {
+        auto found = rows.find(id);
+        if (found == rows.end() || employees[found->second]->getType() != EmployeeType::Hourly)
+        {
+            return false;
+        }
+        return update(id, [hours](Employee *emp)
+                      { static_cast<HourlyEmployee *>(emp)->setWorkHours(hours); });
+    }
+
+    bool setTeamSize(int id, int size)
+    {
+        auto found = rows.find(id);
+        if (found == rows.end() || employees[found->second]->getType() != EmployeeType::Manager)
+        {
+            return false;
+        }
+        return update(id, [size](Employee *emp)
+                      { static_cast<Manager *>(emp)->setTeamSize(size); });
+    }
+
+    // Chế độ kiểm tra: sau mỗi thay đổi, so tổng đang giữ với tổng tính lại từ đầu; nếu lệch thì
+    // tính lại và tăng getTotalMismatches(), không in gì
+    void setVerifyTotals(bool enabled)
+    {
+        verifyTotals = enabled;
+        checkTotals();
+    }
+
+    size_t getTotalMismatches() const
+    {
+        return totalMismatches;
+    }
+
+    bool totalsMatchRecompute() const
+    {
+        return totalByType == columns.salaryByType() && total == columns.totalSalary();
+    }
+    void displayAllEmployees() const
+    {
+        StreamSink sink(std::cout);
+        EmployeeReport report(sink, ReportFormat::Table);
+        report.setRowSeparator("------------------------\n");
+        report.addAll(employees);
+    }
+    void writeReport(std::ostream &stream, ReportFormat format, bool backgroundWriter = false) const
+    {
+        StreamSink sink(stream);
+        EmployeeReport report(sink, format, backgroundWriter);
+        report.addAll(employees);
+    }
+    Money getTotalSalary() const
+    {
+        return total;
+    }
+    Money getTotalSalary(EmployeeType type) const
+    {
+        return totalByType[static_cast<size_t>(type)];
+    }
+    size_t getEmployeeCount() const
+    {
+        return employees.size();
+    }
+    size_t getEmployeeCount(EmployeeType type) const
+    {
+        return countByType[static_cast<size_t>(type)];
+    }
+    const EmployeeColumns &getColumns() const
+    {
+        return columns;
+    }
+};
+
+// Quy tắc tăng lương hàng loạt, ví dụ "+5% cho tuổi > 40" hay "+X mỗi nhân viên cho Manager"
+struct RaiseRule
+{
+    bool anyType = true;
+    EmployeeType type = EmployeeType::Regular;
+    int minAge = INT_MIN; // Khoảng tuổi đóng [minAge, maxAge]
+    int maxAge = INT_MAX;
+
+    Rate rate;            // Tỉ lệ trên lương cơ bản, làm tròn nửa chẵn
+    Money fixedAmount;
+    Money perTeamMember;  // Nhân với số nhân viên quản lý
+
+    static RaiseRule olderThan(int age, Rate rate)
+    {
+        RaiseRule rule;
+        if (age == INT_MAX)
+        {
+            // Không ai lớn hơn INT_MAX tuổi: để khoảng rỗng thay vì tính age + 1 bị tràn
+            rule.minAge = INT_MAX;
+            rule.maxAge = INT_MAX - 1;
+        }
+        else
+        {
+            rule.minAge = age + 1;
+        }
+        rule.rate = rate;
+        return rule;
+    }
+
+    static RaiseRule perManagedEmployee(Money amount)
+    {
+        RaiseRule rule;
+        rule.anyType = false;
+        rule.type = EmployeeType::Manager;
+        rule.perTeamMember = amount;
+        return rule;
+    }
+
+    bool matches(const EmployeeColumns &columns, size_t row) const
+    {
+        const int age = columns.ageAt(row);
+        return (anyType || columns.typeAt(row) == type) && age >= minAge && age <= maxAge;
+    }
+
+    // Lương nhân viên theo giờ chỉ phụ thuộc số giờ, nên tăng theo tỉ lệ hay cố định không áp dụng cho họ;
+    // phần theo số nhân viên quản lý chỉ áp dụng cho Manager (cột teamSize bằng 0 với loại khác)
+    Money amountFor(const EmployeeColumns &columns, size_t row) const
+    {
+        if (columns.typeAt(row) == EmployeeType::Hourly)
+        {
+            return Money();
+        }
+        return columns.baseSalaryAt(row).applyRate(rate) + fixedAmount + perTeamMember * columns.teamSizeAt(row);
+    }
+};
+
+// Kỳ lương gồm months tháng bắt đầu từ month/year. Lương cơ bản và phụ cấp quản lý là mức theo tháng
+// nên được nhân với số tháng; lương theo giờ tính trên số giờ đã ghi cho kỳ.
+struct PayPeriod
+{
+    int year = 0;
+    int month = 1; // 1-12
+    int months = 1;
+
+    bool valid() const
+    {
+        return month >= 1 && month <= 12 && months >= 1 && months <= 12;
+    }
+};
+
+struct PayRunRow
+{
+    int id;
+    EmployeeType type;
+    Money basePay;
+    Money allowance; // Phụ cấp quản lý hoặc lương theo giờ
+    Money grossPay;
+};
+
+struct PayRunResult
+{
+    PayPeriod period;
+    std::vector<PayRunRow> rows;
+    Money totalPay;
+    double seconds = 0;
+};
+
+// Tính lương và áp dụng tăng lương trên toàn bộ bảng cột, chia đều cho các luồng
+class PayrollEngine
+{
+private:
+    unsigned threads;
+
+    // Mọi quy tắc đều tính trên lương trước khi tăng, nên thứ tự quy tắc không ảnh hưởng kết quả
+    std::vector<Money> computeRaises(const EmployeeColumns &columns, const std::vector<RaiseRule> &rules) const
+    {
+        std::vector<Money> raises(columns.size());
+        parallelFor(columns.size(), threads, [&](size_t begin, size_t end, size_t)
+                    {
+            for (size_t row = begin; row < end; ++row)
+            {
+                for (const auto &rule : rules)
+                {
+                    if (rule.matches(columns, row))
+                    {
+                        raises[row] += rule.amountFor(columns, row);
+                    }
+                }
+            } });
+        return raises;
+    }
+
+    bool run(const EmployeeColumns &columns, const PayPeriod &period, PayRunResult &result) const
+    {
+        if (!period.valid())
+        {
+            return false;
+        }
+        const auto started = std::chrono::steady_clock::now();
+        result = PayRunResult();
+        result.period = period;
+        result.rows.resize(columns.size());
+        const size_t parts = std::max<size_t>(1, std::min<size_t>(threads, columns.size()));
+        std::vector<Money> partialTotals(parts);
+        parallelFor(columns.size(), threads, [&](size_t begin, size_t end, size_t part)
+                    {
+            for (size_t row = begin; row < end; ++row)
+            {
+                PayRunRow &out = result.rows[row];
+                out.id = columns.idAt(row);
+                out.type = columns.typeAt(row);
+                out.basePay = columns.baseSalaryAt(row) * period.months;
+                out.allowance = MANAGER_ALLOWANCE_PER_MEMBER * columns.teamSizeAt(row) * period.months +
+                                HOURLY_RATE * columns.workHoursAt(row);
+                out.grossPay = out.basePay + out.allowance;
+                partialTotals[part] += out.grossPay;
+            } });
+        // Cộng số nguyên nên tổng như nhau với mọi số luồng
+        for (Money partial : partialTotals)
+        {
+            result.totalPay += partial;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return true;
+    }
+
+public:
+    explicit PayrollEngine(unsigned _threads = std::thread::hardware_concurrency())
+        : threads(std::max(1u, _threads)) {}
+
+    // Trả về số nhân viên có lương thực nhận thay đổi; quy tắc không áp dụng cho loại nhân viên thì bỏ qua
+    size_t applyRaises(Company &company, const std::vector<RaiseRule> &rules) const
+    {
+        const EmployeeColumns &columns = company.getColumns();
+        const std::vector<Money> raises = computeRaises(columns, rules);
+        std::vector<std::pair<int, Money>> changes;
+        for (size_t row = 0; row < raises.size(); ++row)
+        {
+            if (raises[row] != Money())
+            {
+                changes.emplace_back(columns.idAt(row), raises[row]);
+            }
+        }
+        for (const auto &change : changes)
+        {
+            company.increaseSalary(change.first, change.second);
+        }
+        return changes.size();
+    }
+
+    size_t applyRaises(Department &department, const std::vector<RaiseRule> &rules) const
+    {
+        const EmployeeColumns columns = EmployeeColumns::fromEmployees(department.getEmployees());
+        const std::vector<Money> raises = computeRaises(columns, rules);
+        size_t changed = 0;
+        for (size_t row = 0; row < raises.size(); ++row)
+        {
+            if (raises[row] != Money())
+            {
+                department.increaseSalary(columns.idAt(row), raises[row]);
+                ++changed;
+            }
+        }
+        return changed;
+    }
+
+    // false nếu kỳ lương không hợp lệ; khi đó result không đổi
+    bool run(const Company &company, const PayPeriod &period, PayRunResult &result) const
+    {
+        return run(company.getColumns(), period, result);
+    }
+
+    bool run(const Department &department, const PayPeriod &period, PayRunResult &result) const
+    {
+        return run(EmployeeColumns::fromEmployees(department.getEmployees()), period, result);
+    }
+};
+
+void saveToFile(const std::vector<Employee *> &employees, const std::string &filename)
+{
+    ofstream outFile(filename);
+    if (!outFile)
+    {
+        std::cout << "Error opening file for writing." << std::endl;
+        return;
+    }
+
+    for (const auto &emp : employees)
+    {
+        outFile << emp->serialize() << std::endl;
+    }
+    outFile.close();
+}
+
+void loadFromFile(Department &department, const std::string &filename)
+{
+    ifstream inFile(filename, std::ios::binary);
+    if (!inFile)
+    {
+        std::cout << "Error opening file for reading." << std::endl;
+        return;
+    }
+
+    EmployeeCsvParser parser;
+    std::vector<char> buffer(1 << 20);
+    std::vector<EmployeeRecord> batch;
+    std::vector<CsvError> errors;
+    size_t carried = 0;
+    while (true)
+    {
+        inFile.read(buffer.data() + carried, buffer.size() - carried);
+        const size_t filled = carried + static_cast<size_t>(inFile.gcount());
+        const bool isLast = !inFile;
+        size_t used = parser.parse(std::string_view(buffer.data(), filled), batch, errors, isLast);
+        for (const auto &record : batch)
+        {
+            if (!department.emplaceEmployee<Employee>(record.id, std::string(record.name), record.age, record.salary))
+            {
+                errors.push_back({record.line, "duplicate id " + std::to_string(record.id)});
+            }
+        }
+        batch.clear();
+        parser.clearBatch();
+        if (isLast)
+        {
+            break;
+        }
+        carried = filled - used;
+        std::memmove(buffer.data(), buffer.data() + used, carried);
+        if (carried == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2); // Dòng dài hơn bộ đệm
+        }
+    }
+    for (const auto &error : errors)
+    {
+        std::cout << "Line " << error.line << ": " << error.message << std::endl;
+    }
+}
+
+struct ImportOptions
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkSize = 4 << 20;
+    // true: bộ đệm đọc chỉ giữ khoảng threads * chunkSize byte. Bộ nhớ chỉ bị chặn khi nhận từng dòng
+    // qua onRecord; nhập vào Department thì Department vẫn giữ mọi nhân viên.
+    bool streaming = false;
+    // Chỉ giữ chi tiết của maxErrors lỗi đầu tiên; các lỗi sau chỉ được đếm vào errorCount
+    size_t maxErrors = 1000;
+};
+
+struct ImportStats
+{
+    size_t rows = 0;
+    size_t bytes = 0;
+    double seconds = 0;
+    size_t errorCount = 0;        // Tổng số dòng lỗi, kể cả phần không giữ trong errors
+    std::vector<CsvError> errors; // Theo thứ tự dòng, tối đa ImportOptions::maxErrors
+
+    double rowsPerSecond() const
+    {
+        return seconds > 0 ? rows / seconds : 0;
+    }
+    double bytesPerSecond() const
+    {
+        return seconds > 0 ? bytes / seconds : 0;
+    }
+};
+
+// Nhập file CSV song song: chia cửa sổ dữ liệu thành các khối kết thúc tại '\n',
+// mỗi luồng phân tích một khối, sau đó gọi onRecord cho từng dòng theo đúng thứ tự trong file.
+// record.name chỉ hợp lệ trong lúc gọi. onRecord trả về false nếu id bị trùng. Không giữ lại dòng nào,
+// nên với streaming, file lớn hơn RAM vẫn tính được tổng hợp (đếm, tổng lương...) trong bộ nhớ cố định.
+template <typename RecordSink>
+ImportStats importEmployees(const std::string &filename, const ImportOptions &options, RecordSink onRecord)
+{
+    ImportStats stats;
+    const auto started = std::chrono::steady_clock::now();
+    ifstream inFile(filename, std::ios::binary);
+    if (!inFile)
+    {
+        std::cout << "Error opening file for reading." << std::endl;
+        return stats;
+    }
+
+    const unsigned threadCount = std::max(1u, options.threads);
+    const size_t chunkSize = std::max<size_t>(1, options.chunkSize);
+    size_t windowSize = threadCount * chunkSize;
+    if (!options.streaming)
+    {
+        inFile.seekg(0, std::ios::end);
+        windowSize = std::max<size_t>(windowSize, static_cast<size_t>(inFile.tellg()));
+        inFile.seekg(0, std::ios::beg);
+    }
+
+    auto addError = [&stats, &options](size_t line, std::string message)
+    {
+        if (stats.errorCount++ < options.maxErrors)
+        {
+            stats.errors.push_back({line, std::move(message)});
+        }
+    };
+
+    struct Chunk
+    {
+        std::string_view text;
+        EmployeeCsvParser parser; // Giữ tên đã bỏ escape cho tới khi gộp xong
+        std::vector<EmployeeRecord> records;
+        std::vector<CsvError> errors;
+    };
+
+    std::vector<char> window;
+    size_t carried = 0;
+    size_t baseLine = 0;
+    bool isLast = false;
+    while (!isLast)
+    {
+        window.resize(carried + windowSize);
+        inFile.read(window.data() + carried, windowSize);
+        const size_t read = static_cast<size_t>(inFile.gcount());
+        stats.bytes += read;
+        size_t filled = carried + read;
+        isLast = !inFile || inFile.peek() == std::char_traits<char>::eof();
+
+        // Chia cửa sổ thành các khối, mỗi khối kết thúc ngay sau một dấu xuống dòng
+        std::vector<Chunk> chunks;
+        size_t start = 0;
+        while (start < filled)
+        {
+            size_t end = std::min(start + chunkSize, filled);
+            if (end < filled)
+            {
+                const char *newline = static_cast<const char *>(std::memchr(window.data() + end, '\n', filled - end));
+                end = newline ? static_cast<size_t>(newline - window.data()) + 1 : filled;
+            }
+            if (end == filled && !isLast && window[filled - 1] != '\n')
+            {
+                // Dòng cuối chưa đọc hết, để dành cho cửa sổ sau
+                const char *newline = nullptr;
+                for (size_t i = filled; i > start && !newline; --i)
+                {
+                    if (window[i - 1] == '\n')
+                    {
+                        newline = window.data() + i - 1;
+                    }
+                }
+                if (!newline)
+                {
+                    break;
+                }
+                end = static_cast<size_t>(newline - window.data()) + 1;
+            }
+            Chunk chunk;
+            chunk.text = std::string_view(window.data() + start, end - start);
+            chunks.push_back(std::move(chunk));
+            start = end;
+        }
+
+        std::atomic<size_t> next(0);
+        auto worker = [&chunks, &next]()
+        {
+            for (size_t i = next++; i < chunks.size(); i = next++)
+            {
+                Chunk &chunk = chunks[i];
+                chunk.parser.parse(chunk.text, chunk.records, chunk.errors, true);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < std::min<size_t>(threadCount, chunks.size()); ++t)
+        {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : workers)
+        {
+            thread.join();
+        }
+
+        // Lỗi phân tích và lỗi trùng id của mỗi khối đều theo thứ tự dòng, nên trộn lại là đủ để
+        // errors giữ đúng các lỗi đầu tiên trong file mà không phải sắp xếp
+        for (auto &chunk : chunks)
+        {
+            size_t nextError = 0;
+            for (const auto &record : chunk.records)
+            {
+                for (; nextError < chunk.errors.size() && chunk.errors[nextError].line < record.line; ++nextError)
+                {
+                    addError(baseLine + chunk.errors[nextError].line, std::move(chunk.errors[nextError].message));
+                }
+                if (onRecord(record))
+                {
+                    ++stats.rows;
+                }
+                else
+                {
+                    addError(baseLine + record.line, "duplicate id " + std::to_string(record.id));
+                }
+            }
+            for (; nextError < chunk.errors.size(); ++nextError)
+            {
+                addError(baseLine + chunk.errors[nextError].line, std::move(chunk.errors[nextError].message));
+            }
+            baseLine += chunk.parser.linesRead();
+        }
+
+        carried = filled - start;
+        std::memmove(window.data(), window.data() + start, carried);
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return stats;
+}
+
+// Gộp vào Department: Department giữ mọi nhân viên nên bộ nhớ tăng theo số dòng kể cả khi streaming
+ImportStats importEmployees(Department &department, const std::string &filename, const ImportOptions &options = ImportOptions())
+{
+    return importEmployees(filename, options, [&department](const EmployeeRecord &record)
+                           { return department.emplaceEmployee<Employee>(record.id, std::string(record.name), record.age,
+                                                                        record.salary) != nullptr; });
+}
+
+// Snapshot nhị phân: header, bảng bản ghi độ dài cố định, rồi vùng chứa tên.
+// Dùng thứ tự byte của máy (little-endian trên x86/ARM), mở bằng mmap không cần phân tích.
+const char SNAPSHOT_MAGIC[4] = {'E', 'M', 'P', 'S'};
+const uint32_t SNAPSHOT_VERSION = 2; // 2: lương là số nguyên cố định; 1: lương là double
+
+struct SnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t heapSize;
+};
+
+struct SnapshotRecord
+{
+    int32_t id;
+    int32_t age;
+    int64_t salary; // Money::units(); bản 1 lưu bit của double
+    int32_t extra; // Số giờ làm (Hourly) hoặc số nhân viên quản lý (Manager)
+    uint8_t type;  // EmployeeType
+    uint8_t reserved[3];
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+
+static_assert(sizeof(SnapshotHeader) == 24, "SnapshotHeader layout changed");
+static_assert(sizeof(SnapshotRecord) == 32, "SnapshotRecord layout changed");
+
+// Ghi vào file tạm, fsync rồi đổi tên, nên lỗi giữa chừng không làm hỏng snapshot cũ
+bool saveSnapshot(const std::vector<Employee *> &employees, const std::string &filename)
+{
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof header.magic);
+    header.version = SNAPSHOT_VERSION;
+    header.count = employees.size();
+    header.heapSize = 0;
+    for (const auto &emp : employees)
+    {
+        header.heapSize += emp->getName().size();
+    }
+    if (header.heapSize > UINT32_MAX)
+    {
+        std::cout << "Snapshot name heap is too large." << std::endl;
+        return false;
+    }
+
+    const std::string tempPath = filename + ".tmp";
+    FILE *out = std::fopen(tempPath.c_str(), "wb");
+    if (!out)
+    {
+        std::cout << "Error opening file for writing." << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof header, 1, out) == 1;
+
+    uint32_t offset = 0;
+    for (const auto &emp : employees)
+    {
+        SnapshotRecord record{};
+        record.id = emp->getId();
+        record.age = emp->getAge();
+        record.salary = emp->getBaseSalary().units();
+        record.type = static_cast<uint8_t>(emp->getType());
+        record.extra = emp->getType() == EmployeeType::Hourly ? emp->getWorkHours() : emp->getTeamSize();
+        record.nameOffset = offset;
+        record.nameLength = static_cast<uint32_t>(emp->getName().size());
+        offset += record.nameLength;
+        ok = ok && std::fwrite(&record, sizeof record, 1, out) == 1;
+    }
+    for (const auto &emp : employees)
+    {
+        const std::string &name = emp->getName();
+        ok = ok && std::fwrite(name.data(), 1, name.size(), out) == name.size();
+    }
+    ok = syncAndClose(out) && ok;
+    if (!ok)
+    {
+        std::remove(tempPath.c_str());
+    }
+    if (!ok || !replaceFile(tempPath, filename))
+    {
+        std::cout << "Error writing snapshot." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Ánh xạ file snapshot vào bộ nhớ; bản ghi được đọc trực tiếp từ vùng ánh xạ
+class EmployeeSnapshot
+{
+private:
+    MappedFile file;
+    const char *data = nullptr;
+    size_t length = 0;
+    size_t invalidRecord = SIZE_MAX;
+
+    const SnapshotHeader &header() const
+    {
+        return *reinterpret_cast<const SnapshotHeader *>(data);
+    }
+
+    void close()
+    {
+        file.close();
+        data = nullptr;
+        length = 0;
+    }
+
+    // Loại nhân viên đã biết, tên nằm trong vùng tên và lương đọc được
+    bool validRecord(size_t i) const
+    {
+        const SnapshotRecord &r = record(i);
+        Money salary;
+        return r.type <= static_cast<uint8_t>(EmployeeType::Manager) &&
+               static_cast<uint64_t>(r.nameOffset) + r.nameLength <= header().heapSize && salaryAt(i, salary);
+    }
+
+public:
+    bool open(const std::string &filename)
+    {
+        close();
+        invalidRecord = SIZE_MAX;
+        if (!file.open(filename) || file.size() < sizeof(SnapshotHeader))
+        {
+            close();
+            return false;
+        }
+        data = file.data();
+        length = file.size();
+        const SnapshotHeader &h = header();
+        bool valid = std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof h.magic) == 0 &&
+                     (h.version == SNAPSHOT_VERSION || h.version == 1) &&
+                     h.count <= (length - sizeof(SnapshotHeader)) / sizeof(SnapshotRecord) &&
+                     length == sizeof(SnapshotHeader) + h.count * sizeof(SnapshotRecord) + h.heapSize;
+        for (size_t i = 0; valid && i < h.count; ++i)
+        {
+            if (!validRecord(i))
+            {
+                invalidRecord = i;
+                valid = false;
+            }
+        }
+        if (!valid)
+        {
+            close();
+        }
+        return valid;
+    }
+
+    size_t size() const
+    {
+        return data ? header().count : 0;
+    }
+
+    const SnapshotRecord &record(size_t i) const
+    {
+        return reinterpret_cast<const SnapshotRecord *>(data + sizeof(SnapshotHeader))[i];
+    }
+
+    // false nếu lương không đổi được sang Money (double NaN của phiên bản 1, ngoài ±Money::MAX_UNITS)
+    bool salaryAt(size_t i, Money &salary) const
+    {
+        const SnapshotRecord &r = record(i);
+        if (header().version == 1)
+        {
+            double value;
+            std::memcpy(&value, &r.salary, sizeof value);
+            return Money::fromDouble(value, salary);
+        }
+        return Money::fromUnits(r.salary, salary);
+    }
+
+    // Chỉ gọi sau khi open() thành công: mọi bản ghi đã được kiểm tra nằm trong vùng tên
+    std::string_view nameAt(size_t i) const
+    {
+        const SnapshotRecord &r = record(i);
+        const char *heap = data + sizeof(SnapshotHeader) + size() * sizeof(SnapshotRecord);
+        return std::string_view(heap + r.nameOffset, r.nameLength);
+    }
+
+    // Vị trí bản ghi hỏng đầu tiên khi open() thất bại vì bản ghi; SIZE_MAX nếu lỗi ở header hoặc file
+    size_t firstInvalidRecord() const
+    {
+        return invalidRecord;
+    }
+};
+
+// Nạp tất cả hoặc không nạp gì: bản ghi hỏng (loại lạ, tên ngoài vùng tên, lương không đọc được)
+// hay id trùng (trong file hoặc với nhân viên đã có) làm cả lần nạp thất bại, department không đổi
+bool loadSnapshot(Department &department, const std::string &filename)
+{
+    EmployeeSnapshot snapshot;
+    if (!snapshot.open(filename))
+    {
+        if (snapshot.firstInvalidRecord() != SIZE_MAX)
+        {
+            std::cout << "Snapshot record " << snapshot.firstInvalidRecord() << " is invalid." << std::endl;
+        }
+        else
+        {
+            std::cout << "Error opening snapshot for reading." << std::endl;
+        }
+        return false;
+    }
+    std::unordered_set<int> ids;
+    for (size_t i = 0; i < snapshot.size(); ++i)
+    {
+        const int id = snapshot.record(i).id;
+        if (!ids.insert(id).second || department.findEmployeeById(id))
+        {
+            std::cout << "Snapshot contains duplicate employee id " << id << "." << std::endl;
+            return false;
+        }
+    }
+    for (size_t i = 0; i < snapshot.size(); ++i)
+    {
+        const SnapshotRecord &r = snapshot.record(i);
+        const std::string name(snapshot.nameAt(i));
+        Money salary;
+        snapshot.salaryAt(i, salary);
+        switch (static_cast<EmployeeType>(r.type))
+        {
+        case EmployeeType::Hourly:
+            department.emplaceEmployee<HourlyEmployee>(r.id, name, r.age, r.extra, salary);
+            break;
+        case EmployeeType::Manager:
+            department.emplaceEmployee<Manager>(r.id, name, r.age, salary, r.extra);
+            break;
+        case EmployeeType::Regular:
+            department.emplaceEmployee<Employee>(r.id, name, r.age, salary);
+            break;
+        }
+    }
+    return true;
+}
+
+// Biên dịch với -DEMPLOYEE_NO_MAIN để dùng file này như thư viện (xem bench/)
+#ifndef EMPLOYEE_NO_MAIN
+int main()
+{
+    Company myCompany;
+    myCompany.emplaceEmployee<Employee>(1, "Nguyễn Văn A", 30, Money::of(10000000));
+    myCompany.emplaceEmployee<Employee>(2, "Trần Thị B", 25, Money::of(8000000));
+    myCompany.emplaceEmployee<Manager>(3, "Lê Văn C", 40, Money::of(20000000), 5);
+    std::cout << "Thông tin tất cả nhân viên:" << std::endl;
+    myCompany.displayAllEmployees();
     std::cout << "Tổng lương công ty: " << myCompany.getTotalSalary() << std::endl;
+    PayrollEngine payroll;
+    payroll.applyRaises(myCompany, {RaiseRule::olderThan(35, Rate::percent(5)), RaiseRule::perManagedEmployee(Money::of(500))});
+    std::cout << "Tổng lương sau khi tăng: " << myCompany.getTotalSalary() << std::endl;
 
 
     Department salesDept;
-    salesDept.addEmployee(new Employee(1, "Nguyễn Văn A", 30, 10000000));
-    salesDept.addEmployee(new Employee(2, "Trần Thị B", 25, 8000000));
-    salesDept.addEmployee(new Manager(3, "Lê Văn C", 40, 20000000, 5));
-    salesDept.addEmployee(new HourlyEmployee(4, "Quoc Anh", 20, 4));
-    Employee* e1 = salesDept.findEmployeeById(2);
-    Employee* e2 = salesDept.findEmployeeByName("Lê Văn C");
-    salesDept.sortBySalary();
+    salesDept.emplaceEmployee<Employee>(1, "Nguyễn Văn A", 30, Money::of(10000000));
+    salesDept.emplaceEmployee<Employee>(2, "Trần Thị B", 25, Money::of(8000000));
+    salesDept.emplaceEmployee<Manager>(3, "Lê Văn C", 40, Money::of(20000000), 5);
+    salesDept.emplaceEmployee<HourlyEmployee>(4, "Quoc Anh", 20, 4);
+    const Employee *e1 = salesDept.findEmployeeById(2);
+    const Employee *e2 = salesDept.findEmployeeByName("Lê Văn C");
     std::cout << "\nSap xep theo luong: " << std::endl;
-    salesDept.displayAllEmployees();
-    salesDept.sortByAge();
+    salesDept.displayEmployees(salesDept.sortedBySalary());
     std::cout << "\nSap xep theo tuoi: " << std::endl;
-    salesDept.displayAllEmployees();
+    salesDept.displayEmployees(salesDept.sortedByAge());
 
     std::cout << "\n Ten nhan vien co id 2: " << e1->getName() << std::endl;
     std::cout << "\n Id nhan vien co ten Le Van C: " << e2->getId() << std::endl;
     saveToFile(salesDept.getEmployees(), "employees.txt");
+    saveSnapshot(salesDept.getEmployees(), "employees.bin");
 
     salesDept = Department();
-    loadFromFile(salesDept.getEmployees(), "employees.txt");
+    importEmployees(salesDept, "employees.txt");
     std::cout << "\nLay nhan vien tu file:" << std::endl;
     salesDept.displayAllEmployees();
 
+    salesDept = Department();
+    loadSnapshot(salesDept, "employees.bin");
+    std::cout << "\nLay nhan vien tu snapshot:" << std::endl;
+    salesDept.displayAllEmployees();
+
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -1,135 +1,2242 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <string_view>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <future>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+
+#include "money.h"
+#include "fileio.h"
+#include "parallel_for.h"
+#include "batch_stats.h"
+
+#ifdef _WIN32
+#include <io.h>     // _chsize_s khi cắt log
+#else
+#include <unistd.h> // truncate khi cắt log
+#endif
+
+// Nhật ký ghi trước (write-ahead log): mỗi thao tác thành công được ghi thành một
+// bản ghi [độ dài u32][crc32 u32][nội dung]. Nội dung dùng thứ tự byte của máy.
+// Nội dung bắt đầu bằng byte định dạng (bit cao bật); bản ghi cũ không có byte này
+// và lưu số tiền, lãi suất dạng double.
+enum class LogOp : uint8_t {
+    OpenAccount = 1,
+    OpenSavings,
+    OpenFixedDeposit,
+    Deposit,
+    Withdraw,
+    Transfer,
+    Checkpoint,
+    InterestRun
+};
+
+struct LogRecord {
+    LogOp op = LogOp::Checkpoint;
+    uint64_t lsn = 0;      // Số thứ tự bản ghi, tăng dần
+    std::string account;
+    std::string other;     // Tên chủ tài khoản (Open*) hoặc tài khoản nhận (Transfer)
+    Money amount;          // Số tiền, hoặc số dư ban đầu với Open*
+    Rate rate;
+    int32_t term = 0;
+    int32_t periodsAccrued = 0; // Số kỳ đã tính lãi của tài khoản có kỳ hạn
+};
+
+class TransactionLog {
+private:
+    static const uint32_t MAX_RECORD_SIZE = 1 << 20;
+    static constexpr uint8_t RECORD_FORMAT = 0x80 | 2; // 2: số tiền và lãi suất là số nguyên cố định
+
+    std::string path;
+    FILE* file = nullptr;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::string pending;   // Bản ghi chờ ghi ở lần fsync tiếp theo
+    std::string writing;   // Bộ đệm đang được luồng commit ghi ra
+    uint64_t nextLsn = 1;
+    uint64_t durableLsn = 0;
+    uint64_t bytesWritten = 0;
+    bool committing = false;
+    bool stopping = false;
+    // Lỗi ghi/fsync là vĩnh viễn cho tới reset(): sau lỗi, file có thể chứa bản ghi ghi dở nên
+    // không ghi tiếp (recover sẽ dừng ở chỗ hỏng và bỏ mọi thứ phía sau), mọi LSN chưa bền đều báo lỗi
+    bool failed = false;
+    std::thread committer;
+
+    template <typename T>
+    static void put(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof value);
+    }
+
+    static void putString(std::string& out, const std::string& value) {
+        put(out, static_cast<uint32_t>(value.size()));
+        out += value;
+    }
+
+    template <typename T>
+    static bool get(std::string_view& in, T& value) {
+        if (in.size() < sizeof value) {
+            return false;
+        }
+        std::memcpy(&value, in.data(), sizeof value);
+        in.remove_prefix(sizeof value);
+        return true;
+    }
+
+    static bool getString(std::string_view& in, std::string& value) {
+        uint32_t size;
+        if (!get(in, size) || in.size() < size) {
+            return false;
+        }
+        value.assign(in.data(), size);
+        in.remove_prefix(size);
+        return true;
+    }
+
+    // Group commit: mỗi vòng ghi toàn bộ bản ghi đang chờ rồi fsync một lần
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) {
+                return;
+            }
+            if (failed) {
+                pending.clear();
+                continue;
+            }
+            writing.swap(pending);
+            const uint64_t upTo = nextLsn - 1;
+            committing = true;
+            lock.unlock();
+            const bool ok = std::fwrite(writing.data(), 1, writing.size(), file) == writing.size() && syncFile(file);
+            lock.lock();
+            committing = false;
+            bytesWritten += writing.size();
+            writing.clear();
+            if (ok) {
+                durableLsn = upTo;
+            }
+            else {
+                failed = true;
+            }
+            changed.notify_all();
+        }
+    }
+
+public:
+    // previous: crc của phần dữ liệu trước đó, để tính nối tiếp theo từng khối
+    static uint32_t crc32(const char* data, size_t size, uint32_t previous = 0) {
+        static uint32_t table[256];
+        static const bool ready = [] {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                table[i] = c;
+            }
+            return true;
+        }();
+        (void)ready;
+        uint32_t crc = previous ^ 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    static void encode(const LogRecord& record, std::string& out) {
+        const size_t start = out.size();
+        put(out, uint32_t(0));
+        put(out, uint32_t(0));
+        put(out, RECORD_FORMAT);
+        put(out, static_cast<uint8_t>(record.op));
+        put(out, record.lsn);
+        putString(out, record.account);
+        putString(out, record.other);
+        put(out, record.amount.units());
+        put(out, record.rate.partsPerBillion());
+        put(out, record.term);
+        put(out, record.periodsAccrued);
+        const uint32_t size = static_cast<uint32_t>(out.size() - start - 8);
+        const uint32_t crc = crc32(out.data() + start + 8, size);
+        std::memcpy(&out[start], &size, sizeof size);
+        std::memcpy(&out[start + 4], &crc, sizeof crc);
+    }
+
+    // Đọc lần lượt các bản ghi hợp lệ; dừng ở bản ghi hỏng hoặc ghi dở đầu tiên.
+    // Trả về số byte hợp lệ tính từ đầu file (0 nếu file không tồn tại).
+    static size_t read(const std::string& filename, const std::function<void(const LogRecord&)>& apply) {
+        FILE* in = std::fopen(filename.c_str(), "rb");
+        if (!in) {
+            return 0;
+        }
+        std::string data;
+        char chunk[1 << 16];
+        size_t got;
+        while ((got = std::fread(chunk, 1, sizeof chunk, in)) > 0) {
+            data.append(chunk, got);
+        }
+        std::fclose(in);
+
+        size_t offset = 0;
+        while (data.size() - offset >= 8) {
+            uint32_t size, crc;
+            std::memcpy(&size, data.data() + offset, sizeof size);
+            std::memcpy(&crc, data.data() + offset + 4, sizeof crc);
+            if (size > MAX_RECORD_SIZE || data.size() - offset - 8 < size || crc32(data.data() + offset + 8, size) != crc) {
+                break;
+            }
+            std::string_view body(data.data() + offset + 8, size);
+            LogRecord record;
+            uint8_t op;
+            if (!get(body, op)) {
+                break;
+            }
+            const bool legacy = !(op & 0x80);
+            if (!legacy && (op != RECORD_FORMAT || !get(body, op))) {
+                break;
+            }
+            // CRC đúng nhưng mã thao tác lạ cũng là hết dữ liệu hợp lệ, không phát lại
+            if (op < static_cast<uint8_t>(LogOp::OpenAccount) || op > static_cast<uint8_t>(LogOp::InterestRun)) {
+                break;
+            }
+            if (!get(body, record.lsn) || !getString(body, record.account) || !getString(body, record.other)) {
+                break;
+            }
+            if (legacy) {
+                double amount, rate;
+                if (!get(body, amount) || !get(body, rate) ||
+                    !Money::fromDouble(amount, record.amount) || !Rate::fromDouble(rate, record.rate)) {
+                    break;
+                }
+            }
+            else {
+                int64_t units, partsPerBillion;
+                if (!get(body, units) || !get(body, partsPerBillion) || !Money::fromUnits(units, record.amount)) {
+                    break;
+                }
+                record.rate = Rate::fromPartsPerBillion(partsPerBillion);
+            }
+            if (!get(body, record.term)) {
+                break;
+            }
+            get(body, record.periodsAccrued); // Không có trong bản ghi cũ
+            record.op = static_cast<LogOp>(op);
+            apply(record);
+            offset += 8 + size;
+        }
+        return offset;
+    }
+
+    TransactionLog() = default;
+    TransactionLog(const TransactionLog&) = delete;
+    TransactionLog& operator=(const TransactionLog&) = delete;
+
+    // File không có bộ đệm stdio: mỗi vòng commit đã là một lần ghi lớn, và sau lỗi không còn byte
+    // nào nằm lại trong bộ đệm để bị ghi vào log mới khi reset() đóng handle cũ
+    bool open(const std::string& filename, uint64_t firstLsn) {
+        close();
+        file = std::fopen(filename.c_str(), "ab");
+        if (!file) {
+            return false;
+        }
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        path = filename;
+        nextLsn = firstLsn;
+        durableLsn = firstLsn - 1;
+        failed = false;
+        stopping = false;
+        committer = std::thread(&TransactionLog::run, this);
+        return true;
+    }
+
+    // Gán LSN và xếp bản ghi vào hàng chờ; gọi waitDurable(lsn) để đợi fsync.
+    // Sau lỗi ghi, bản ghi không được ghi nữa và waitDurable của LSN đó trả về false.
+    uint64_t append(LogRecord record) {
+        std::lock_guard<std::mutex> lock(mutex);
+        record.lsn = nextLsn++;
+        if (!failed) {
+            encode(record, pending);
+            changed.notify_all();
+        }
+        return record.lsn;
+    }
+
+    // Trả về false nếu ghi xuống đĩa thất bại, ở lần ghi chứa lsn hoặc ở bất kỳ lần nào trước đó
+    bool waitDurable(uint64_t lsn) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this, lsn] { return durableLsn >= lsn || failed; });
+        return durableLsn >= lsn;
+    }
+
+    uint64_t lastLsn() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return nextLsn - 1;
+    }
+
+    uint64_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return bytesWritten;
+    }
+
+    // Xoá nội dung log sau khi snapshot đã chứa mọi bản ghi; LSN vẫn tiếp tục tăng.
+    // Mở file mới trước rồi mới đóng file cũ: nếu không mở được thì giữ nguyên log và handle cũ.
+    // Đây là nơi duy nhất xoá lỗi ghi trước đó, vì snapshot đã chứa các bản ghi đó.
+    bool reset() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return !committing && (pending.empty() || failed); });
+        FILE* fresh = std::fopen(path.c_str(), "wb");
+        if (!fresh) {
+            return false;
+        }
+        std::setvbuf(fresh, nullptr, _IONBF, 0);
+        const bool synced = syncFile(fresh);
+        std::fclose(file);
+        file = fresh;
+        bytesWritten = 0;
+        pending.clear();
+        durableLsn = nextLsn - 1;
+        failed = !synced;
+        changed.notify_all();
+        return synced;
+    }
+
+    void close() {
+        if (!committer.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        committer.join();
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    ~TransactionLog() {
+        close();
+    }
+};
+
+// Dùng khi không cần làm gì thêm trong lúc đang giữ khoá tài khoản
+struct NoHook {
+    void operator()() const {}
+};
+
+class Account {
+protected:
+    std::string accountNumber;
+    std::string ownerName;
+    Money balance;
+    mutable std::mutex mutex; // Bảo vệ balance
+
+public:
+    Account(const std::string& number, const std::string& name, Money initialBalance)
+        : accountNumber(number), ownerName(name), balance(initialBalance) {}
+
+    // Các hàm try* an toàn khi gọi từ nhiều luồng và không in ra màn hình.
+    // onApplied được gọi khi thao tác thành công, lúc vẫn còn giữ khoá (ví dụ để ghi log
+    // đúng thứ tự áp dụng). Nạp hoặc chuyển tiền làm số dư đích tràn int64_t thì thất bại, số dư không đổi.
+    template <typename OnApplied = NoHook>
+    bool tryDeposit(Money amount, OnApplied onApplied = OnApplied()) {
+        if (amount <= Money()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!Money::add(balance, amount, balance)) {
+            return false;
+        }
+        onApplied();
+        return true;
+    }
+
+    template <typename OnApplied = NoHook>
+    bool tryWithdraw(Money amount, OnApplied onApplied = OnApplied()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (amount > Money() && balance >= amount) {
+            balance -= amount;
+            onApplied();
+            return true;
+        }
+        return false;
+    }
+
+    // Khoá cả hai tài khoản theo thứ tự số tài khoản để không bị deadlock,
+    // nên rút và nạp xảy ra cùng lúc: tổng tiền không đổi dù có tranh chấp
+    template <typename OnApplied = NoHook>
+    bool tryTransfer(Account* toAccount, Money amount, OnApplied onApplied = OnApplied()) {
+        if (toAccount == this) {
+            return false;
+        }
+        Account* first = accountNumber < toAccount->accountNumber ? this : toAccount;
+        Account* second = first == this ? toAccount : this;
+        std::lock_guard<std::mutex> lockFirst(first->mutex);
+        std::lock_guard<std::mutex> lockSecond(second->mutex);
+        if (amount > Money() && balance >= amount && Money::add(toAccount->balance, amount, toAccount->balance)) {
+            balance -= amount;
+            onApplied();
+            return true;
+        }
+        return false;
+    }
+
+    // Bản ghi log đủ để tạo lại tài khoản với số dư hiện tại
+    virtual LogRecord openRecord() const {
+        LogRecord record;
+        record.op = LogOp::OpenAccount;
+        record.account = accountNumber;
+        record.other = ownerName;
+        record.amount = getBalance();
+        return record;
+    }
+
+    virtual void deposit(Money amount) {
+        if (tryDeposit(amount)) {
+            std::cout << "Da nap " << amount << " vao tai khoan." << std::endl;
+        }
+        else {
+            std::cout << "So tien khong hop le." << std::endl;
+        }
+    }
+
+    virtual bool withdraw(Money amount) {
+        if (tryWithdraw(amount)) {
+            std::cout << "Da rut " << amount << " tu tai khoan." << std::endl;
+            return true;
+        }
+        std::cout << "Khong the rut tien. So du khong du hoac so tien khong hop le." << std::endl;
+        return false;
+    }
+
+    bool transfer(Account* toAccount, Money amount) {
+        if (tryTransfer(toAccount, amount)) {
+            std::cout << "Da chuyen " << amount << " tu tai khoan " << accountNumber
+                << " den tai khoan " << toAccount->accountNumber << "." << std::endl;
+            return true;
+        }
+        std::cout << "Khong the chuyen tien. So du khong du hoac so tien khong hop le." << std::endl;
+        return false;
+    }
+
+    virtual void displayInfo() const {
+        std::cout << "So tai khoan: " << accountNumber << std::endl;
+        std::cout << "Chu tai khoan: " << ownerName << std::endl;
+        std::cout << "So du: " << getBalance() << std::endl;
+    }
+
+    Money getBalance() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return balance;
+    }
+
+    virtual Rate getInterestRate() const {
+        return Rate();
+    }
+
+    // Số dư dùng để tính lãi; eligible = false nếu kỳ này tài khoản không được tính lãi
+    virtual Money interestBase(bool& eligible) const {
+        eligible = false;
+        return getBalance();
+    }
+
+    // false (số dư không đổi) nếu số dư mới tràn int64_t
+    virtual bool creditInterest(Money interest) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return Money::add(balance, interest, balance);
+    }
+
+    virtual ~Account() = default;
+
+    const std::string& getAccountNumber() const {
+        return accountNumber;
+    }
+
+    const std::string& getOwnerName() const {
+        return ownerName;
+    }
+};
+
+class SavingsAccount : public Account {
+private:
+    Rate interestRate; // Lãi suất tháng
+
+public:
+    SavingsAccount(const std::string& number, const std::string& name, Money initialBalance, Rate rate)
+        : Account(number, name, initialBalance), interestRate(rate) {}
+
+    void applyInterest() {
+        Money interest;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!balance.applyRate(interestRate, interest) || !Money::add(balance, interest, balance)) {
+                std::cout << "So du vuot gioi han, khong the cong lai." << std::endl;
+                return;
+            }
+        }
+        std::cout << "Da cong lai: " << interest << std::endl;
+    }
+
+    void displayInfo() const override {
+        Account::displayInfo();
+        std::cout << "Lai suat: " << (interestRate.toDouble() * 100) << "%" << std::endl;
+    }
+
+    LogRecord openRecord() const override {
+        LogRecord record = Account::openRecord();
+        record.op = LogOp::OpenSavings;
+        record.rate = interestRate;
+        return record;
+    }
+
+    Rate getInterestRate() const override {
+        return interestRate;
+    }
+
+    Money interestBase(bool& eligible) const override {
+        eligible = true;
+        return getBalance();
+    }
+};
+
+class FixedDepositAccount : public Account {
+private:
+    Rate interestRate; // Lãi suất tháng
+    int term; // Thời hạn gửi tiền (tháng)
+    int periodsAccrued; // Số tháng đã tính lãi, không vượt quá term
+
+public:
+    FixedDepositAccount(const std::string& number, const std::string& name, Money initialBalance, Rate rate, int termMonths,
+        int accrued = 0)
+        : Account(number, name, initialBalance), interestRate(rate), term(termMonths), periodsAccrued(accrued) {}
+
+    void applyInterest() {
+        Money interest;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (periodsAccrued >= term) {
+                std::cout << "Tai khoan da het ky han." << std::endl;
+                return;
+            }
+            if (!balance.applyRate(interestRate, interest) || !Money::add(balance, interest, balance)) {
+                std::cout << "So du vuot gioi han, khong the cong lai." << std::endl;
+                return;
+            }
+            ++periodsAccrued;
+        }
+        std::cout << "Da cong lai: " << interest << std::endl;
+    }
+
+    void displayInfo() const override {
+        Account::displayInfo();
+        std::cout << "Lai suat: " << (interestRate.toDouble() * 100) << "%" << std::endl;
+        std::cout << "Thoi han: " << term << " thang" << std::endl;
+    }
+
+    LogRecord openRecord() const override {
+        LogRecord record = Account::openRecord();
+        record.op = LogOp::OpenFixedDeposit;
+        record.rate = interestRate;
+        record.term = term;
+        std::lock_guard<std::mutex> lock(mutex);
+        record.periodsAccrued = periodsAccrued;
+        return record;
+    }
+
+    Rate getInterestRate() const override {
+        return interestRate;
+    }
+
+    // Chỉ tính lãi trong thời hạn gửi
+    Money interestBase(bool& eligible) const override {
+        std::lock_guard<std::mutex> lock(mutex);
+        eligible = periodsAccrued < term;
+        return balance;
+    }
+
+    bool creditInterest(Money interest) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!Money::add(balance, interest, balance)) {
+            return false;
+        }
+        ++periodsAccrued;
+        return true;
+    }
+};
+
+enum class OperationType : uint8_t {
+    Deposit,
+    Withdraw,
+    Transfer
+};
+
+struct Operation {
+    OperationType type;
+    std::string account;
+    std::string toAccount; // Chỉ dùng cho Transfer
+    Money amount;
+};
+
+enum class OperationResult : uint8_t {
+    Ok,
+    InvalidAmount,
+    AccountNotFound,
+    SameAccount,
+    InsufficientFunds,
+    LogFailure // Đã áp dụng trong bộ nhớ nhưng chưa ghi được xuống log
+};
+
+// Bảng băm địa chỉ mở (dò tuyến tính) từ số tài khoản sang Account*.
+// Mỗi ô lưu sẵn mã băm nên chỉ so sánh chuỗi khi mã băm trùng nhau.
+class AccountIndex {
+private:
+    struct Slot {
+        uint64_t hash;
+        Account* account; // nullptr: ô trống
+    };
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    void place(uint64_t hash, Account* account) {
+        const size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i].account) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = { hash, account };
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity, Slot{ 0, nullptr });
+        old.swap(slots);
+        for (const auto& slot : old) {
+            if (slot.account) {
+                place(slot.hash, slot.account);
+            }
+        }
+    }
+
+public:
+    // FNV-1a rồi trộn thêm để các bit thấp (dùng làm chỉ số) phân bố đều
+    static uint64_t hashOf(std::string_view key) {
+        uint64_t hash = 1469598103934665603ull;
+        for (unsigned char c : key) {
+            hash = (hash ^ c) * 1099511628211ull;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    Account* find(std::string_view number) const {
+        if (slots.empty()) {
+            return nullptr;
+        }
+        const uint64_t hash = hashOf(number);
+        const size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; slots[i].account; i = (i + 1) & mask) {
+            if (slots[i].hash == hash && slots[i].account->getAccountNumber() == number) {
+                return slots[i].account;
+            }
+        }
+        return nullptr;
+    }
+
+    // Trả về false nếu số tài khoản đã tồn tại
+    bool insert(Account* account) {
+        if (find(account->getAccountNumber())) {
+            return false;
+        }
+        if ((count + 1) * 10 > slots.size() * 7) { // Giữ hệ số tải <= 0.7
+            rehash(slots.empty() ? 16 : slots.size() * 2);
+        }
+        place(hashOf(account->getAccountNumber()), account);
+        ++count;
+        return true;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Cấp phát trước đủ ô cho n tài khoản, tránh băm lại nhiều lần khi nạp hàng loạt
+    void reserve(size_t n) {
+        size_t capacity = slots.empty() ? 16 : slots.size();
+        while (n * 10 > capacity * 7) {
+            capacity *= 2;
+        }
+        if (capacity > slots.size()) {
+            rehash(capacity);
+        }
+    }
+};
+
+// Snapshot nhị phân của Bank: [header][bản ghi cố định × count][vùng chuỗi]. Mỗi bản ghi
+// trỏ vào vùng chuỗi (số tài khoản rồi tên chủ), nên file được mmap và đọc thẳng, không phân tích.
+// Dùng thứ tự byte của máy; crc phủ toàn bộ phần sau header.
+const char BANK_SNAPSHOT_MAGIC[4] = { 'B', 'N', 'K', 'S' };
+const uint32_t BANK_SNAPSHOT_VERSION = 1;
+
+struct BankSnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t heapSize;
+    uint64_t lsn; // LSN cuối cùng đã nằm trong snapshot
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+struct BankSnapshotRecord {
+    int64_t balance; // Money::units()
+    int64_t rate;    // Rate::partsPerBillion()
+    uint64_t stringOffset;
+    uint32_t numberLength;
+    uint32_t ownerLength;
+    int32_t term;
+    int32_t periodsAccrued;
+    uint8_t type;    // LogOp::OpenAccount, OpenSavings hoặc OpenFixedDeposit
+    uint8_t reserved[7];
+};
+
+static_assert(sizeof(BankSnapshotHeader) == 40, "BankSnapshotHeader layout changed");
+static_assert(sizeof(BankSnapshotRecord) == 48, "BankSnapshotRecord layout changed");
+
+// Ánh xạ file snapshot vào bộ nhớ (Windows: đọc cả file) và kiểm tra header, kích thước, crc
+class BankSnapshotFile {
+private:
+    MappedFile file;
+    const char* data = nullptr;
+    size_t length = 0;
+
+    const BankSnapshotHeader& header() const {
+        return *reinterpret_cast<const BankSnapshotHeader*>(data);
+    }
+
+    const char* heap() const {
+        return data + sizeof(BankSnapshotHeader) + size() * sizeof(BankSnapshotRecord);
+    }
+
+    const BankSnapshotRecord& record(size_t i) const {
+        return reinterpret_cast<const BankSnapshotRecord*>(data + sizeof(BankSnapshotHeader))[i];
+    }
+
+    // Loại bản ghi là Open* và chuỗi nằm trong vùng chuỗi
+    bool valid(const BankSnapshotRecord& r) const {
+        return r.type >= static_cast<uint8_t>(LogOp::OpenAccount) && r.type <= static_cast<uint8_t>(LogOp::OpenFixedDeposit) &&
+            r.stringOffset <= header().heapSize &&
+            header().heapSize - r.stringOffset >= uint64_t(r.numberLength) + r.ownerLength;
+    }
+
+    void close() {
+        file.close();
+        data = nullptr;
+        length = 0;
+    }
+
+public:
+    BankSnapshotFile() = default;
+    BankSnapshotFile(const BankSnapshotFile&) = delete;
+    BankSnapshotFile& operator=(const BankSnapshotFile&) = delete;
+
+    // Chỉ đọc magic, để phân biệt với snapshot dạng bản ghi log cũ
+    static bool isBinary(const std::string& filename) {
+        char magic[sizeof BANK_SNAPSHOT_MAGIC] = {};
+        FILE* in = std::fopen(filename.c_str(), "rb");
+        if (!in) {
+            return false;
+        }
+        const bool ok = std::fread(magic, 1, sizeof magic, in) == sizeof magic;
+        std::fclose(in);
+        return ok && std::memcmp(magic, BANK_SNAPSHOT_MAGIC, sizeof magic) == 0;
+    }
+
+    bool open(const std::string& filename) {
+        close();
+        if (!file.open(filename) || file.size() < sizeof(BankSnapshotHeader)) {
+            file.close();
+            return false;
+        }
+        data = file.data();
+        length = file.size();
+        const BankSnapshotHeader& h = header();
+        const size_t body = length - sizeof(BankSnapshotHeader);
+        const bool valid = std::memcmp(h.magic, BANK_SNAPSHOT_MAGIC, sizeof h.magic) == 0 &&
+            h.version == BANK_SNAPSHOT_VERSION && h.count <= body / sizeof(BankSnapshotRecord) &&
+            h.heapSize == body - h.count * sizeof(BankSnapshotRecord) &&
+            TransactionLog::crc32(data + sizeof(BankSnapshotHeader), body) == h.crc;
+        if (!valid) {
+            close();
+        }
+        return valid;
+    }
+
+    size_t size() const {
+        return data ? header().count : 0;
+    }
+
+    uint64_t lsn() const {
+        return data ? header().lsn : 0;
+    }
+
+    // Trả về false nếu loại bản ghi không phải Open*, bản ghi trỏ ra ngoài vùng chuỗi
+    // hoặc số dư ngoài ±Money::MAX_UNITS
+    bool read(size_t i, LogRecord& out) const {
+        const BankSnapshotRecord& r = record(i);
+        if (!valid(r) || !Money::fromUnits(r.balance, out.amount)) {
+            return false;
+        }
+        const char* strings = heap() + r.stringOffset;
+        out.op = static_cast<LogOp>(r.type);
+        out.account.assign(strings, r.numberLength);
+        out.other.assign(strings + r.numberLength, r.ownerLength);
+        out.rate = Rate::fromPartsPerBillion(r.rate);
+        out.term = r.term;
+        out.periodsAccrued = r.periodsAccrued;
+        return true;
+    }
+
+    // Kiểm tra mọi bản ghi ngay trên vùng ánh xạ, không sao chép chuỗi: false ở bản ghi hỏng đầu
+    // tiên hoặc số tài khoản lặp lại, để người gọi bỏ cả snapshot trước khi tạo tài khoản nào.
+    // Sau khi validate() thành công, read() không thất bại.
+    bool validate() const {
+        std::unordered_set<std::string_view> numbers;
+        numbers.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            const BankSnapshotRecord& r = record(i);
+            if (!valid(r) || !Money::inRange(r.balance) ||
+                !numbers.insert(std::string_view(heap() + r.stringOffset, r.numberLength)).second) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Đo số lần gọi, số lần thất bại và độ trễ của các thao tác Bank. Mỗi luồng ghi vào
+// khối đếm riêng (không tranh chấp cache line), khi đọc thì cộng dồn các khối.
+// Biên dịch với -DBANK_NO_METRICS để loại bỏ hoàn toàn phần đo.
+enum class BankOp : uint8_t {
+    FindAccount,
+    Deposit,
+    Withdraw,
+    Transfer
+};
+
+const size_t BANK_OP_COUNT = 4;
+
+#ifndef BANK_NO_METRICS
+inline const char* bankOpName(BankOp op) {
+    static const char* const names[BANK_OP_COUNT] = { "findAccount", "deposit", "withdraw", "transfer" };
+    return names[static_cast<size_t>(op)];
+}
+
+// Histogram kiểu HDR: giá trị < 64 ns được đếm chính xác, từ đó mỗi khoảng [2^k, 2^(k+1))
+// chia thành 32 ô đều nhau, nên sai số tương đối không quá 1/32.
+class LatencyBuckets {
+public:
+    static const unsigned SUB_BITS = 5;
+    static const uint64_t SUB_COUNT = 1 << SUB_BITS;
+    static const unsigned MAX_BITS = 40; // Giá trị lớn hơn ~18 phút được gộp vào ô cuối
+    static const size_t COUNT = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+    static size_t indexOf(uint64_t nanos) {
+        nanos = std::min<uint64_t>(nanos, (1ull << MAX_BITS) - 1);
+#if defined(__GNUC__)
+        const unsigned highest = nanos ? 63 - __builtin_clzll(nanos) : 0;
+#else
+        unsigned highest = 0;
+        for (uint64_t v = nanos; v > 1; v >>= 1) {
+            ++highest;
+        }
+#endif
+        const unsigned shift = highest > SUB_BITS ? highest - SUB_BITS : 0;
+        return shift * SUB_COUNT + (nanos >> shift);
+    }
+
+    // Giá trị lớn nhất thuộc ô index
+    static uint64_t upperBound(size_t index) {
+        const unsigned shift = index < 2 * SUB_COUNT ? 0 : static_cast<unsigned>(index / SUB_COUNT - 1);
+        return ((index - shift * SUB_COUNT + 1) << shift) - 1;
+    }
+};
+
+struct OpStats {
+    uint64_t calls = 0;
+    uint64_t failures = 0;
+    uint64_t totalNanos = 0;
+    uint64_t maxNanos = 0;
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(LatencyBuckets::COUNT, 0);
+
+    // Giá trị phân vị p (0..100), làm tròn lên cận trên của ô
+    uint64_t percentile(double p) const {
+        if (calls == 0) {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100 * calls + 0.999999));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return std::min(LatencyBuckets::upperBound(i), maxNanos);
+            }
+        }
+        return maxNanos;
+    }
+};
+
+struct MetricsSnapshot {
+    OpStats ops[BANK_OP_COUNT];
+
+    std::string toText() const {
+        std::string out;
+        char line[256];
+        for (size_t i = 0; i < BANK_OP_COUNT; ++i) {
+            const OpStats& s = ops[i];
+            std::snprintf(line, sizeof line,
+                "%-12s goi %llu, loi %llu, tb %.0f ns, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu ns\n",
+                bankOpName(static_cast<BankOp>(i)), static_cast<unsigned long long>(s.calls),
+                static_cast<unsigned long long>(s.failures), s.calls ? double(s.totalNanos) / s.calls : 0.0,
+                static_cast<unsigned long long>(s.percentile(50)), static_cast<unsigned long long>(s.percentile(90)),
+                static_cast<unsigned long long>(s.percentile(99)), static_cast<unsigned long long>(s.percentile(99.9)),
+                static_cast<unsigned long long>(s.maxNanos));
+            out += line;
+        }
+        return out;
+    }
+
+    std::string toJson() const {
+        std::string out = "{";
+        char field[256];
+        for (size_t i = 0; i < BANK_OP_COUNT; ++i) {
+            const OpStats& s = ops[i];
+            std::snprintf(field, sizeof field,
+                "%s\"%s\":{\"calls\":%llu,\"failures\":%llu,\"meanNs\":%.1f,\"p50Ns\":%llu,\"p90Ns\":%llu,"
+                "\"p99Ns\":%llu,\"p999Ns\":%llu,\"maxNs\":%llu}",
+                i ? "," : "", bankOpName(static_cast<BankOp>(i)), static_cast<unsigned long long>(s.calls),
+                static_cast<unsigned long long>(s.failures), s.calls ? double(s.totalNanos) / s.calls : 0.0,
+                static_cast<unsigned long long>(s.percentile(50)), static_cast<unsigned long long>(s.percentile(90)),
+                static_cast<unsigned long long>(s.percentile(99)), static_cast<unsigned long long>(s.percentile(99.9)),
+                static_cast<unsigned long long>(s.maxNanos));
+            out += field;
+        }
+        return out + "}";
+    }
+};
+
+class BankMetrics {
+private:
+    // Chỉ luồng sở hữu ghi, nên dùng load + store relaxed thay cho phép cộng nguyên tử
+    struct Counter {
+        std::atomic<uint64_t> value{ 0 };
+
+        void add(uint64_t n) {
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        uint64_t get() const {
+            return value.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct alignas(64) ThreadBlock {
+        Counter calls[BANK_OP_COUNT];
+        Counter failures[BANK_OP_COUNT];
+        Counter totalNanos[BANK_OP_COUNT];
+        Counter maxNanos[BANK_OP_COUNT];
+        Counter buckets[BANK_OP_COUNT][LatencyBuckets::COUNT];
+    };
+
+    std::mutex mutex;
+    std::vector<ThreadBlock*> live;
+    MetricsSnapshot retired; // Số liệu của các luồng đã kết thúc
+
+    static void mergeInto(MetricsSnapshot& out, const ThreadBlock& block) {
+        for (size_t op = 0; op < BANK_OP_COUNT; ++op) {
+            OpStats& s = out.ops[op];
+            s.calls += block.calls[op].get();
+            s.failures += block.failures[op].get();
+            s.totalNanos += block.totalNanos[op].get();
+            s.maxNanos = std::max(s.maxNanos, block.maxNanos[op].get());
+            for (size_t i = 0; i < LatencyBuckets::COUNT; ++i) {
+                s.buckets[i] += block.buckets[op][i].get();
+            }
+        }
+    }
+
+    // Khối của luồng hiện tại, đăng ký ở lần dùng đầu tiên và gộp vào retired khi luồng kết thúc
+    struct ThreadHandle {
+        ThreadBlock* block;
+
+        ThreadHandle() : block(new ThreadBlock()) {
+            BankMetrics& metrics = instance();
+            std::lock_guard<std::mutex> lock(metrics.mutex);
+            metrics.live.push_back(block);
+        }
+
+        ~ThreadHandle() {
+            BankMetrics& metrics = instance();
+            std::lock_guard<std::mutex> lock(metrics.mutex);
+            mergeInto(metrics.retired, *block);
+            metrics.live.erase(std::find(metrics.live.begin(), metrics.live.end(), block));
+            delete block;
+        }
+    };
+
+    static ThreadBlock& local() {
+        thread_local ThreadHandle handle;
+        return *handle.block;
+    }
+
+public:
+    static BankMetrics& instance() {
+        static BankMetrics metrics;
+        return metrics;
+    }
+
+    static void record(BankOp op, uint64_t nanos, bool ok) {
+        ThreadBlock& block = local();
+        const size_t i = static_cast<size_t>(op);
+        block.calls[i].add(1);
+        block.failures[i].add(ok ? 0 : 1);
+        block.totalNanos[i].add(nanos);
+        if (nanos > block.maxNanos[i].get()) {
+            block.maxNanos[i].value.store(nanos, std::memory_order_relaxed);
+        }
+        block.buckets[i][LatencyBuckets::indexOf(nanos)].add(1);
+    }
+
+    // Cộng dồn mọi khối; các luồng vẫn ghi tiếp trong lúc đọc nên số liệu có thể lệch vài lần gọi
+    MetricsSnapshot snapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        MetricsSnapshot result = retired;
+        for (const ThreadBlock* block : live) {
+            mergeInto(result, *block);
+        }
+        return result;
+    }
+};
+
+// Đo thời gian từ lúc tạo đến finish(); kết quả chuyển thành bool để biết thành công hay không
+class OpTimer {
+private:
+    BankOp op;
+    std::chrono::steady_clock::time_point started;
+
+public:
+    explicit OpTimer(BankOp _op) : op(_op), started(std::chrono::steady_clock::now()) {}
+
+    template <typename T>
+    T finish(T result) {
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+        BankMetrics::record(op, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+            static_cast<bool>(result));
+        return result;
+    }
+};
+#else
+class OpTimer {
+public:
+    explicit OpTimer(BankOp) {}
+
+    template <typename T>
+    T finish(T result) {
+        return result;
+    }
+};
+#endif
+
+class Bank {
+private:
+    std::vector<Account*> accounts;
+    AccountIndex index;
+    // Bảo vệ accounts và index. Các thao tác qua Bank giữ khoá chia sẻ suốt thao tác,
+    // checkpoint giữ khoá độc quyền để chụp trạng thái nhất quán.
+    mutable std::shared_mutex accountsMutex;
+    std::unique_ptr<TransactionLog> log; // nullptr: không ghi log
+
+    // Danh sách tài khoản có lãi và lãi suất của chúng, để đợt tính lãi hằng tháng không phải
+    // duyệt mọi tài khoản. Số dư vẫn nằm trong từng Account (có khoá riêng), không có cột số dư chung.
+    std::vector<Account*> interestAccounts;
+    std::vector<Rate> interestRates;
+
+    bool insertAccount(Account* account) {
+        if (!index.insert(account)) {
+            return false;
+        }
+        accounts.emplace_back(account);
+        if (account->getInterestRate() != Rate()) {
+            interestAccounts.push_back(account);
+            interestRates.push_back(account->getInterestRate());
+        }
+        return true;
+    }
+
+    // Mỗi luồng xử lý một đoạn theo kiểu gom/rải: đọc số dư từng tài khoản (hàm ảo, khoá từng tài
+    // khoản) vào mảng tạm, tính lãi trên mảng, rồi cộng lãi trở lại từng tài khoản (khoá lần nữa).
+    // Vòng tính lãi dùng phép nhân/chia __int128 nên không được vector hoá; song song hoá chỉ nhờ
+    // chia đoạn cho các luồng. Lãi làm tròn nửa chẵn theo từng tài khoản và tổng là phép cộng
+    // số nguyên, nên kết quả không phụ thuộc số luồng và phát lại log cho cùng kết quả.
+    // Tài khoản có tiền lãi hoặc số dư mới tràn int64_t thì không được cộng lãi kỳ này (số dư giữ nguyên);
+    // tổng trả về chỉ để báo cáo nên bão hoà thay vì báo lỗi.
+    Money runMonthlyInterest(unsigned threads) {
+        const size_t n = interestAccounts.size();
+        std::vector<Money> balances(n), interest(n);
+        std::vector<unsigned char> eligible(n);
+        const size_t parts = std::max<size_t>(1, std::min<size_t>(threads, n));
+        std::vector<Money> partialTotals(parts);
+        parallelFor(n, threads, [&](size_t begin, size_t end, size_t part) {
+            for (size_t i = begin; i < end; ++i) {
+                bool canAccrue;
+                balances[i] = interestAccounts[i]->interestBase(canAccrue);
+                eligible[i] = canAccrue;
+            }
+            const Rate* rate = interestRates.data();
+            for (size_t i = begin; i < end; ++i) {
+                eligible[i] = eligible[i] && balances[i].applyRate(rate[i], interest[i]);
+            }
+            Money subtotal;
+            for (size_t i = begin; i < end; ++i) {
+                if (eligible[i] && interestAccounts[i]->creditInterest(interest[i])) {
+                    subtotal += interest[i];
+                }
+            }
+            partialTotals[part] = subtotal;
+        });
+        Money total;
+        for (Money subtotal : partialTotals) {
+            total += subtotal;
+        }
+        return total;
+    }
+
+    // Tạo tài khoản từ bản ghi Open*; nullptr với loại bản ghi khác
+    static Account* createAccount(const LogRecord& record) {
+        switch (record.op) {
+        case LogOp::OpenAccount:
+            return new Account(record.account, record.other, record.amount);
+        case LogOp::OpenSavings:
+            return new SavingsAccount(record.account, record.other, record.amount, record.rate);
+        case LogOp::OpenFixedDeposit:
+            return new FixedDepositAccount(record.account, record.other, record.amount, record.rate, record.term,
+                record.periodsAccrued);
+        default:
+            return nullptr;
+        }
+    }
+
+    // Áp dụng lại một bản ghi khi khôi phục, không ghi log
+    void apply(const LogRecord& record) {
+        Account* created = nullptr;
+        switch (record.op) {
+        case LogOp::OpenAccount:
+        case LogOp::OpenSavings:
+        case LogOp::OpenFixedDeposit:
+            created = createAccount(record);
+            break;
+        case LogOp::Deposit:
+            if (Account* account = index.find(record.account)) {
+                account->tryDeposit(record.amount);
+            }
+            break;
+        case LogOp::Withdraw:
+            if (Account* account = index.find(record.account)) {
+                account->tryWithdraw(record.amount);
+            }
+            break;
+        case LogOp::Transfer: {
+            Account* from = index.find(record.account);
+            Account* to = index.find(record.other);
+            if (from && to) {
+                from->tryTransfer(to, record.amount);
+            }
+            break;
+        }
+        case LogOp::InterestRun:
+            runMonthlyInterest(1);
+            break;
+        case LogOp::Checkpoint:
+            break;
+        }
+        if (created && !insertAccount(created)) {
+            delete created;
+        }
+    }
+
+    LogRecord operationRecord(LogOp op, std::string_view account, std::string_view other, Money amount) const {
+        LogRecord record;
+        record.op = op;
+        record.account = std::string(account);
+        record.other = std::string(other);
+        record.amount = amount;
+        return record;
+    }
+
+    // Ghi snapshot nhị phân theo luồng (bộ đệm 1 MiB) vào file tạm, fsync rồi đổi tên.
+    // Người gọi giữ khoá độc quyền để trạng thái nhất quán.
+    bool writeSnapshot(const std::string& path, uint64_t lsn) const {
+        const std::string tempPath = path + ".tmp";
+        FILE* out = std::fopen(tempPath.c_str(), "wb");
+        if (!out) {
+            return false;
+        }
+        std::setvbuf(out, nullptr, _IOFBF, 1 << 20);
+        BankSnapshotHeader header{};
+        std::memcpy(header.magic, BANK_SNAPSHOT_MAGIC, sizeof header.magic);
+        header.version = BANK_SNAPSHOT_VERSION;
+        header.count = accounts.size();
+        header.lsn = lsn;
+        bool ok = std::fwrite(&header, sizeof header, 1, out) == 1;
+
+        uint32_t crc = 0;
+        uint64_t offset = 0;
+        for (const auto& account : accounts) {
+            const LogRecord open = account->openRecord();
+            BankSnapshotRecord record{};
+            record.balance = open.amount.units();
+            record.rate = open.rate.partsPerBillion();
+            record.stringOffset = offset;
+            record.numberLength = static_cast<uint32_t>(open.account.size());
+            record.ownerLength = static_cast<uint32_t>(open.other.size());
+            record.term = open.term;
+            record.periodsAccrued = open.periodsAccrued;
+            record.type = static_cast<uint8_t>(open.op);
+            offset += record.numberLength + record.ownerLength;
+            crc = TransactionLog::crc32(reinterpret_cast<const char*>(&record), sizeof record, crc);
+            ok = ok && std::fwrite(&record, sizeof record, 1, out) == 1;
+        }
+        for (const auto& account : accounts) {
+            for (const std::string* text : { &account->getAccountNumber(), &account->getOwnerName() }) {
+                crc = TransactionLog::crc32(text->data(), text->size(), crc);
+                ok = ok && std::fwrite(text->data(), 1, text->size(), out) == text->size();
+            }
+        }
+        header.heapSize = offset;
+        header.crc = crc;
+        ok = ok && std::fseek(out, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof header, 1, out) == 1;
+        ok = syncAndClose(out) && ok;
+        if (!ok) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return replaceFile(tempPath, path);
+    }
+
+    bool durable(uint64_t lsn) {
+        return !log || lsn == 0 || log->waitDurable(lsn);
+    }
+
+    static BankOp bankOpOf(OperationType type) {
+        return type == OperationType::Deposit ? BankOp::Deposit
+            : type == OperationType::Withdraw ? BankOp::Withdraw : BankOp::Transfer;
+    }
+
+    // Ghi số đo (chỉ Ok tính là thành công) rồi trả lại mã kết quả
+    static OperationResult finishOperation(OpTimer& timer, OperationResult result) {
+        timer.finish(result == OperationResult::Ok);
+        return result;
+    }
+
+public:
+    // Trả về false nếu số tài khoản đã tồn tại; khi đó người gọi vẫn sở hữu account.
+    // Khi có log, chỉ trả về sau khi việc mở tài khoản đã được ghi xuống đĩa.
+    bool addAccount(Account* account) {
+        uint64_t lsn = 0;
+        {
+            std::unique_lock<std::shared_mutex> lock(accountsMutex);
+            if (!insertAccount(account)) {
+                return false;
+            }
+            if (log) {
+                lsn = log->append(account->openRecord());
+            }
+        }
+        return durable(lsn);
+    }
+
+    // Chỉ tra cứu, không in gì khi không tìm thấy
+    Account* findAccount(std::string_view number) const {
+        OpTimer timer(BankOp::FindAccount);
+        std::shared_lock<std::shared_mutex> lock(accountsMutex);
+        return timer.finish(index.find(number));
+    }
+
+    // Các thao tác dưới đây an toàn khi gọi đồng thời từ nhiều luồng. Khi có log,
+    // bản ghi được thêm trong lúc giữ khoá tài khoản (để thứ tự log trùng thứ tự áp dụng)
+    // và hàm chỉ trả về Ok sau khi bản ghi đã được fsync. Không tìm thấy tài khoản thì trả về
+    // AccountNotFound, nên người gọi không cần findAccount trước.
+    OperationResult deposit(std::string_view number, Money amount) {
+        OpTimer timer(BankOp::Deposit);
+        uint64_t lsn = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(accountsMutex);
+            Account* account = index.find(number);
+            if (!account) {
+                return finishOperation(timer, OperationResult::AccountNotFound);
+            }
+            if (!account->tryDeposit(amount, [&] {
+                    if (log) {
+                        lsn = log->append(operationRecord(LogOp::Deposit, number, {}, amount));
+                    }
+                })) {
+                return finishOperation(timer, OperationResult::InvalidAmount);
+            }
+        }
+        return finishOperation(timer, durable(lsn) ? OperationResult::Ok : OperationResult::LogFailure);
+    }
+
+    OperationResult withdraw(std::string_view number, Money amount) {
+        OpTimer timer(BankOp::Withdraw);
+        uint64_t lsn = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(accountsMutex);
+            Account* account = index.find(number);
+            if (!account) {
+                return finishOperation(timer, OperationResult::AccountNotFound);
+            }
+            if (amount <= Money()) {
+                return finishOperation(timer, OperationResult::InvalidAmount);
+            }
+            if (!account->tryWithdraw(amount, [&] {
+                    if (log) {
+                        lsn = log->append(operationRecord(LogOp::Withdraw, number, {}, amount));
+                    }
+                })) {
+                return finishOperation(timer, OperationResult::InsufficientFunds);
+            }
+        }
+        return finishOperation(timer, durable(lsn) ? OperationResult::Ok : OperationResult::LogFailure);
+    }
+
+    OperationResult transfer(std::string_view fromNumber, std::string_view toNumber, Money amount) {
+        OpTimer timer(BankOp::Transfer);
+        uint64_t lsn = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(accountsMutex);
+            Account* from = index.find(fromNumber);
+            Account* to = index.find(toNumber);
+            if (!from || !to) {
+                return finishOperation(timer, OperationResult::AccountNotFound);
+            }
+            if (amount <= Money()) {
+                return finishOperation(timer, OperationResult::InvalidAmount);
+            }
+            if (from == to) {
+                return finishOperation(timer, OperationResult::SameAccount);
+            }
+            if (!from->tryTransfer(to, amount, [&] {
+                    if (log) {
+                        lsn = log->append(operationRecord(LogOp::Transfer, fromNumber, toNumber, amount));
+                    }
+                })) {
+                return finishOperation(timer, OperationResult::InsufficientFunds);
+            }
+        }
+        return finishOperation(timer, durable(lsn) ? OperationResult::Ok : OperationResult::LogFailure);
+    }
 
-#include <iostream>
-#include <string>
-#include <vector>
-#include <limits>
+    // Xử lý một lô thao tác, trả về mã kết quả cho từng thao tác (không in gì).
+    // Các thao tác được chia theo nhóm tài khoản liên thông (qua các lệnh chuyển tiền);
+    // mỗi nhóm chạy tuần tự theo thứ tự trong lô, các nhóm khác nhau chạy song song.
+    // Khi có log, hàm đợi một lần fsync cho cả lô. Số đo của mỗi thao tác chỉ gồm bước kiểm tra và
+    // áp dụng của riêng nó, không gồm lần chờ fsync chung (khác deposit/withdraw/transfer lẻ).
+    std::vector<OperationResult> processBatch(const std::vector<Operation>& operations,
+        unsigned threads = std::thread::hardware_concurrency()) {
+        const size_t n = operations.size();
+        std::vector<OperationResult> results(n, OperationResult::Ok);
+        std::vector<Account*> from(n, nullptr), to(n, nullptr);
+        std::shared_lock<std::shared_mutex> lock(accountsMutex);
 
-class Account {
-protected:
-    std::string accountNumber;
-    std::string ownerName;
-    double balance;
+        // Kiểm tra và gán mỗi tài khoản một số hiệu liên tiếp cho union-find
+        std::unordered_map<Account*, size_t> slotOf;
+        std::vector<size_t> parent;
+        auto slot = [&](Account* account) {
+            auto inserted = slotOf.emplace(account, parent.size());
+            if (inserted.second) {
+                parent.push_back(parent.size());
+            }
+            return inserted.first->second;
+        };
+        auto root = [&](size_t x) {
+            while (parent[x] != x) {
+                parent[x] = parent[parent[x]];
+                x = parent[x];
+            }
+            return x;
+        };
+        for (size_t i = 0; i < n; ++i) {
+            const Operation& op = operations[i];
+            from[i] = index.find(op.account);
+            if (op.type == OperationType::Transfer) {
+                to[i] = index.find(op.toAccount);
+            }
+            if (op.amount <= Money()) {
+                results[i] = OperationResult::InvalidAmount;
+            }
+            else if (!from[i] || (op.type == OperationType::Transfer && !to[i])) {
+                results[i] = OperationResult::AccountNotFound;
+            }
+            else if (from[i] == to[i]) {
+                results[i] = OperationResult::SameAccount;
+            }
+            if (results[i] != OperationResult::Ok) {
+                OpTimer(bankOpOf(op.type)).finish(false);
+            }
+            else {
+                const size_t a = slot(from[i]);
+                if (to[i]) {
+                    parent[root(a)] = root(slot(to[i]));
+                }
+            }
+        }
 
-public:
-    Account(const std::string& number, const std::string& name, double initialBalance)
-        : accountNumber(number), ownerName(name), balance(initialBalance) {}
+        // Gom thao tác hợp lệ theo nhóm, giữ nguyên thứ tự trong lô
+        std::unordered_map<size_t, size_t> groupOf;
+        std::vector<std::vector<size_t>> groups;
+        for (size_t i = 0; i < n; ++i) {
+            if (results[i] != OperationResult::Ok) {
+                continue;
+            }
+            auto inserted = groupOf.emplace(root(slotOf[from[i]]), groups.size());
+            if (inserted.second) {
+                groups.emplace_back();
+            }
+            groups[inserted.first->second].push_back(i);
+        }
 
-    virtual void deposit(double amount) {
-        if (amount > 0) {
-            balance += amount;
-            std::cout << "Da nap " << amount << " vao tai khoan." << std::endl;
+        std::atomic<size_t> nextGroup(0);
+        std::atomic<uint64_t> lastLsn(0);
+        auto worker = [&] {
+            uint64_t workerLsn = 0;
+            for (size_t g = nextGroup++; g < groups.size(); g = nextGroup++) {
+                for (size_t i : groups[g]) {
+                    const Operation& op = operations[i];
+                    OpTimer timer(bankOpOf(op.type));
+                    auto logged = [&] {
+                        if (log) {
+                            const LogOp logOp = op.type == OperationType::Deposit ? LogOp::Deposit
+                                : op.type == OperationType::Withdraw ? LogOp::Withdraw : LogOp::Transfer;
+                            workerLsn = std::max(workerLsn, log->append(operationRecord(logOp, op.account, op.toAccount, op.amount)));
+                        }
+                    };
+                    bool applied = false;
+                    switch (op.type) {
+                    case OperationType::Deposit:
+                        applied = from[i]->tryDeposit(op.amount, logged);
+                        break;
+                    case OperationType::Withdraw:
+                        applied = from[i]->tryWithdraw(op.amount, logged);
+                        break;
+                    case OperationType::Transfer:
+                        applied = from[i]->tryTransfer(to[i], op.amount, logged);
+                        break;
+                    }
+                    if (!timer.finish(applied)) {
+                        // Như deposit(): nạp chỉ thất bại khi số dư đích tràn
+                        results[i] = op.type == OperationType::Deposit ? OperationResult::InvalidAmount
+                            : OperationResult::InsufficientFunds;
+                    }
+                }
+            }
+            uint64_t seen = lastLsn.load();
+            while (workerLsn > seen && !lastLsn.compare_exchange_weak(seen, workerLsn)) {
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < std::min<size_t>(std::max(1u, threads), groups.size()); ++t) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : workers) {
+            thread.join();
+        }
+        lock.unlock();
+
+        if (!durable(lastLsn)) {
+            for (auto& result : results) {
+                if (result == OperationResult::Ok) {
+                    result = OperationResult::LogFailure;
+                }
+            }
+        }
+        return results;
+    }
+
+    // Tính lãi một tháng cho mọi tài khoản tiết kiệm và có kỳ hạn: lãi suất là lãi suất tháng, và
+    // mỗi lần chạy là một trong term tháng của tài khoản có kỳ hạn (hết kỳ hạn thì không tính nữa),
+    // nên chỉ chạy một lần mỗi tháng. Chặn các thao tác khác qua Bank trong lúc chạy.
+    // total nhận tổng tiền lãi đã cộng; trả về false nếu không ghi được bản ghi vào log.
+    bool accrueMonthlyInterest(Money& total, unsigned threads = std::thread::hardware_concurrency()) {
+        std::unique_lock<std::shared_mutex> lock(accountsMutex);
+        total = runMonthlyInterest(std::max(1u, threads));
+        uint64_t lsn = 0;
+        if (log) {
+            lsn = log->append(operationRecord(LogOp::InterestRun, {}, {}, total));
+        }
+        lock.unlock();
+        return durable(lsn);
+    }
+
+    // Khôi phục từ snapshot rồi phát lại các bản ghi mới hơn trong log, sau đó
+    // mở log để ghi tiếp. Phần cuối log bị ghi dở (khi sập nguồn) được cắt bỏ. Snapshot có
+    // bản ghi hỏng thì trả về false trước khi nạp tài khoản nào và không mở log.
+    bool recover(const std::string& snapshotPath, const std::string& logPath) {
+        std::unique_lock<std::shared_mutex> lock(accountsMutex);
+        uint64_t snapshotLsn = 0;
+        if (BankSnapshotFile::isBinary(snapshotPath)) {
+            BankSnapshotFile snapshot;
+            // Không mở log để tránh ghi chồng lên trạng thái chưa khôi phục được
+            if (!snapshot.open(snapshotPath) || !snapshot.validate()) {
+                return false;
+            }
+            accounts.reserve(snapshot.size());
+            index.reserve(snapshot.size());
+            LogRecord record;
+            for (size_t i = 0; i < snapshot.size(); ++i) {
+                snapshot.read(i, record);
+                apply(record);
+            }
+            snapshotLsn = snapshot.lsn();
         }
         else {
-            std::cout << "So tien khong hop le." << std::endl;
+            // Snapshot cũ: chuỗi bản ghi log, bản ghi Checkpoint chứa LSN. Snapshot luôn được ghi trọn
+            // (file tạm rồi đổi tên), nên còn byte nào không đọc được thì file hỏng (ví dụ magic của
+            // snapshot nhị phân bị hỏng), không phải chưa có dữ liệu.
+            const size_t validBytes = TransactionLog::read(snapshotPath, [&](const LogRecord& record) {
+                if (record.op == LogOp::Checkpoint) {
+                    snapshotLsn = record.lsn;
+                }
+                else {
+                    apply(record);
+                }
+            });
+            if (FILE* existing = std::fopen(snapshotPath.c_str(), "rb")) {
+                const bool whole = std::fseek(existing, 0, SEEK_END) == 0 &&
+                    std::ftell(existing) == static_cast<long>(validBytes);
+                std::fclose(existing);
+                if (!whole) {
+                    return false;
+                }
+            }
+        }
+        uint64_t lastLsn = snapshotLsn;
+        const size_t validBytes = TransactionLog::read(logPath, [&](const LogRecord& record) {
+            if (record.lsn > snapshotLsn) {
+                apply(record);
+            }
+            lastLsn = std::max(lastLsn, record.lsn);
+        });
+        if (FILE* existing = std::fopen(logPath.c_str(), "rb")) {
+            std::fclose(existing);
+#ifdef _WIN32
+            FILE* truncated = std::fopen(logPath.c_str(), "r+b");
+            if (truncated) {
+                _chsize_s(_fileno(truncated), validBytes);
+                std::fclose(truncated);
+            }
+#else
+            if (truncate(logPath.c_str(), static_cast<off_t>(validBytes)) != 0) {
+                return false;
+            }
+#endif
+        }
+        log.reset(new TransactionLog());
+        if (!log->open(logPath, lastLsn + 1)) {
+            log.reset();
+            return false;
         }
+        return true;
     }
 
-    virtual bool withdraw(double amount) {
-        if (amount > 0 && balance >= amount) {
-            balance -= amount;
-            std::cout << "Da rut " << amount << " tu tai khoan." << std::endl;
-            return true;
+    // Ghi snapshot toàn bộ tài khoản rồi xoá log.
+    // Nếu sập giữa chừng, LSN trong snapshot giúp bỏ qua các bản ghi log đã có trong đó.
+    bool checkpoint(const std::string& snapshotPath) {
+        std::unique_lock<std::shared_mutex> lock(accountsMutex);
+        if (!writeSnapshot(snapshotPath, log ? log->lastLsn() : 0)) {
+            return false;
         }
-        std::cout << "Khong the rut tien. So du khong du hoac so tien khong hop le." << std::endl;
-        return false;
+        return !log || log->reset();
     }
 
-    void transfer(Account* toAccount, double amount) {
-        if (withdraw(amount)) {
-            toAccount->deposit(amount);
-            std::cout << "Da chuyen " << amount << " tu tai khoan " << accountNumber
-                << " den tai khoan " << toAccount->accountNumber << "." << std::endl;
+    // Xuất snapshot nhị phân ra file khác, không động đến log
+    bool exportSnapshot(const std::string& path) {
+        std::unique_lock<std::shared_mutex> lock(accountsMutex);
+        return writeSnapshot(path, log ? log->lastLsn() : 0);
+    }
+
+    // Nạp tài khoản từ một snapshot nhị phân, bỏ qua số tài khoản đã tồn tại. Snapshot có bản ghi
+    // hỏng bị từ chối cả file, không nạp tài khoản nào.
+    // Mỗi tài khoản nạp được ghi vào log như khi mở mới; chỉ đợi fsync một lần ở cuối.
+    bool importSnapshot(const std::string& path, size_t& imported) {
+        imported = 0;
+        BankSnapshotFile snapshot;
+        if (!snapshot.open(path) || !snapshot.validate()) {
+            return false;
+        }
+        uint64_t lsn = 0;
+        {
+            std::unique_lock<std::shared_mutex> lock(accountsMutex);
+            accounts.reserve(accounts.size() + snapshot.size());
+            index.reserve(index.size() + snapshot.size());
+            LogRecord record;
+            for (size_t i = 0; i < snapshot.size(); ++i) {
+                snapshot.read(i, record);
+                Account* created = createAccount(record);
+                if (!insertAccount(created)) {
+                    delete created;
+                    continue;
+                }
+                if (log) {
+                    lsn = log->append(record);
+                }
+                ++imported;
+            }
         }
+        return durable(lsn);
     }
 
-    virtual void displayInfo() const {
-        std::cout << "So tai khoan: " << accountNumber << std::endl;
-        std::cout << "Chu tai khoan: " << ownerName << std::endl;
-        std::cout << "So du: " << balance << std::endl;
+    // Số byte đã ghi vào log kể từ checkpoint gần nhất
+    uint64_t logSize() const {
+        return log ? log->size() : 0;
     }
 
-    virtual ~Account() = default;
+    // Chỉ chính xác khi không có giao dịch nào đang chạy
+    Money totalBalance() const {
+        std::shared_lock<std::shared_mutex> lock(accountsMutex);
+        Money total;
+        for (const auto& account : accounts) {
+            total += account->getBalance();
+        }
+        return total;
+    }
 
-    const std::string& getAccountNumber() const {
-        return accountNumber;
+    void displayAllAccounts() const {
+        std::shared_lock<std::shared_mutex> lock(accountsMutex);
+        for (const auto& account : accounts) {
+            account->displayInfo();
+            std::cout << "------------------------" << std::endl;
+        }
+    }
+
+    ~Bank() {
+        log.reset(); // Đợi ghi hết log trước khi huỷ tài khoản
+        for (auto account : accounts) {
+            delete account;
+        }
     }
 };
 
-class SavingsAccount : public Account {
+// Ngân hàng chia tài khoản thành nhiều phân mảnh theo mã băm số tài khoản. Mỗi phân mảnh
+// do đúng một luồng xử lý, nhận yêu cầu qua hàng đợi không khoá (nhiều luồng gửi, một luồng
+// nhận), nên tài khoản trong phân mảnh không bị tranh chấp và không cần khoá toàn cục.
+// Chuyển tiền giữa hai phân mảnh chạy theo hai pha: phân mảnh nguồn trừ tiền rồi chuyển
+// yêu cầu sang phân mảnh đích để cộng; nếu không có tài khoản đích hoặc số dư đích sẽ tràn thì
+// trả tiền lại nguồn (giữ ở pendingRefunds nếu chưa cộng lại được).
+// Chỉ giữ trong bộ nhớ, không ghi log.
+class ShardedBank {
+public:
+    using Callback = std::function<void(OperationResult)>;
+
 private:
-    double interestRate;
+    struct Shard;
 
-public:
-    SavingsAccount(const std::string& number, const std::string& name, double initialBalance, double rate)
-        : Account(number, name, initialBalance), interestRate(rate) {}
+    struct Request {
+        enum class Kind : uint8_t {
+            Deposit,
+            Withdraw,
+            Transfer,
+            Credit, // Pha 2: cộng tiền ở phân mảnh đích
+            Refund, // Hoàn tiền về nguồn khi không cộng được vào đích (kết quả trong refundResult)
+            Task    // Chạy task trên luồng của phân mảnh
+        };
 
-    void applyInterest() {
-        double interest = balance * interestRate;
-        deposit(interest);
-        std::cout << "Da cong lai: " << interest << std::endl;
+        std::atomic<Request*> next{ nullptr };
+        Kind kind = Kind::Task;
+        OperationResult refundResult = OperationResult::AccountNotFound;
+        std::string account;
+        std::string toAccount;
+        Money amount;
+        Callback done;
+        std::function<void(Shard&)> task;
+    };
+
+    // Hàng đợi MPSC xâm nhập của Vyukov: push là một lệnh exchange, không khoá.
+    // Nút được trả về nguyên vẹn nên một yêu cầu có thể chuyển tiếp sang hàng đợi khác.
+    class RequestQueue {
+    private:
+        Request stub;
+        std::atomic<Request*> tail; // Đầu ghi, các luồng gửi dùng chung
+        Request* head;              // Đầu đọc, chỉ luồng của phân mảnh dùng
+
+    public:
+        RequestQueue() : tail(&stub), head(&stub) {}
+
+        void push(Request* request) {
+            request->next.store(nullptr, std::memory_order_relaxed);
+            Request* previous = tail.exchange(request, std::memory_order_acq_rel);
+            previous->next.store(request, std::memory_order_release);
+        }
+
+        // Trả về nullptr khi rỗng hoặc khi luồng gửi chưa nối xong nút cuối
+        Request* pop() {
+            Request* first = head;
+            Request* next = first->next.load(std::memory_order_acquire);
+            if (first == &stub) {
+                if (!next) {
+                    return nullptr;
+                }
+                head = next;
+                first = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                head = next;
+                return first;
+            }
+            if (first != tail.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            push(&stub);
+            next = first->next.load(std::memory_order_acquire);
+            if (next) {
+                head = next;
+                return first;
+            }
+            return nullptr;
+        }
+
+        bool empty() const {
+            return head == &stub && !stub.next.load(std::memory_order_acquire);
+        }
+    };
+
+    struct Shard {
+        RequestQueue queue;
+        std::vector<Account*> accounts;
+        AccountIndex index;
+        // Tiền hoàn chưa cộng lại được vào nguồn (số dư nguồn sẽ tràn); thử lại trước mỗi yêu cầu
+        // sau đó trên phân mảnh và vẫn được tính trong totalBalance, nên tổng tiền luôn bảo toàn
+        std::vector<std::pair<std::string, Money>> pendingRefunds;
+        std::atomic<bool> sleeping{ false };
+        std::mutex parkMutex;
+        std::condition_variable wake;
+        std::thread worker;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> stopping{ false };
+    std::atomic<size_t> outstanding{ 0 }; // Số yêu cầu chưa hoàn tất
+    std::mutex drainMutex;
+    std::condition_variable drained;
+
+    // Dùng các bit cao của mã băm, vì bit thấp là chỉ số ô trong AccountIndex của phân mảnh
+    Shard& shardOf(std::string_view number) {
+        return *shards[(AccountIndex::hashOf(number) >> 32) % shards.size()];
     }
 
-    void displayInfo() const override {
-        Account::displayInfo();
-        std::cout << "Lai suat: " << (interestRate * 100) << "%" << std::endl;
+    void send(Shard& shard, Request* request) {
+        shard.queue.push(request);
+        // Cặp với hàng rào trong run(): hoặc luồng gửi thấy sleeping, hoặc luồng nhận thấy yêu cầu mới
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shard.sleeping.load()) {
+            std::lock_guard<std::mutex> lock(shard.parkMutex);
+            shard.wake.notify_one();
+        }
     }
-};
 
-class FixedDepositAccount : public Account {
-private:
-    double interestRate;
-    int term; // Thời hạn gửi tiền (tháng)
+    void submit(Request* request) {
+        ++outstanding;
+        send(shardOf(request->account), request);
+    }
 
-public:
-    FixedDepositAccount(const std::string& number, const std::string& name, double initialBalance, double rate, int termMonths)
-        : Account(number, name, initialBalance), interestRate(rate), term(termMonths) {}
+    void complete(Request* request, OperationResult result) {
+        if (request->done) {
+            request->done(result);
+        }
+        delete request;
+        if (--outstanding == 0) {
+            std::lock_guard<std::mutex> lock(drainMutex);
+            drained.notify_all();
+        }
+    }
 
-    void applyInterest() {
-        double interest = balance * interestRate;
-        deposit(interest);
-        std::cout << "Da cong lai: " << interest << std::endl;
+    void retryRefunds(Shard& shard) {
+        auto& pending = shard.pendingRefunds;
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [&shard](const std::pair<std::string, Money>& refund) {
+            Account* account = shard.index.find(refund.first);
+            return account && account->tryDeposit(refund.second);
+        }), pending.end());
     }
 
-    void displayInfo() const override {
-        Account::displayInfo();
-        std::cout << "Lai suat: " << (interestRate * 100) << "%" << std::endl;
-        std::cout << "Thoi han: " << term << " thang" << std::endl;
+    void handle(Shard& shard, Request* request) {
+        using Kind = Request::Kind;
+        if (!shard.pendingRefunds.empty()) {
+            retryRefunds(shard);
+        }
+        switch (request->kind) {
+        case Kind::Deposit: {
+            Account* account = shard.index.find(request->account);
+            if (!account) {
+                complete(request, OperationResult::AccountNotFound);
+            }
+            else {
+                complete(request, account->tryDeposit(request->amount) ? OperationResult::Ok : OperationResult::InvalidAmount);
+            }
+            break;
+        }
+        case Kind::Withdraw: {
+            Account* account = shard.index.find(request->account);
+            complete(request, !account ? OperationResult::AccountNotFound
+                : account->tryWithdraw(request->amount) ? OperationResult::Ok : OperationResult::InsufficientFunds);
+            break;
+        }
+        case Kind::Transfer: {
+            Account* from = shard.index.find(request->account);
+            Shard& target = shardOf(request->toAccount);
+            if (!from) {
+                complete(request, OperationResult::AccountNotFound);
+            }
+            else if (&target == &shard) {
+                Account* to = shard.index.find(request->toAccount);
+                complete(request, !to ? OperationResult::AccountNotFound
+                    : from->tryTransfer(to, request->amount) ? OperationResult::Ok : OperationResult::InsufficientFunds);
+            }
+            else if (!from->tryWithdraw(request->amount)) {
+                complete(request, OperationResult::InsufficientFunds);
+            }
+            else {
+                request->kind = Kind::Credit;
+                send(target, request);
+            }
+            break;
+        }
+        case Kind::Credit: {
+            Account* to = shard.index.find(request->toAccount);
+            if (to && to->tryDeposit(request->amount)) {
+                complete(request, OperationResult::Ok);
+            }
+            else {
+                // Không có tài khoản đích, hoặc số dư đích sẽ tràn
+                request->refundResult = to ? OperationResult::InvalidAmount : OperationResult::AccountNotFound;
+                request->kind = Kind::Refund;
+                send(shardOf(request->account), request);
+            }
+            break;
+        }
+        case Kind::Refund: {
+            // Số dư nguồn có thể đã tăng từ lúc trừ tiền nên cộng lại cũng có thể tràn
+            Account* from = shard.index.find(request->account);
+            if (!from || !from->tryDeposit(request->amount)) {
+                shard.pendingRefunds.emplace_back(request->account, request->amount);
+            }
+            complete(request, request->refundResult);
+            break;
+        }
+        case Kind::Task:
+            request->task(shard);
+            complete(request, OperationResult::Ok);
+            break;
+        }
     }
-};
 
-class Bank {
-private:
-    std::vector<Account*> accounts;
+    // Quay vòng ngắn khi hết việc rồi mới ngủ; luồng gửi đánh thức khi thấy sleeping
+    void run(Shard& shard) {
+        unsigned idle = 0;
+        while (true) {
+            if (Request* request = shard.queue.pop()) {
+                handle(shard, request);
+                idle = 0;
+                continue;
+            }
+            if (stopping.load() && shard.queue.empty()) {
+                return;
+            }
+            if (++idle < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(shard.parkMutex);
+            shard.sleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            shard.wake.wait(lock, [&] { return !shard.queue.empty() || stopping.load(); });
+            shard.sleeping.store(false);
+            idle = 0;
+        }
+    }
+
+    Request* operationRequest(const Operation& op, Callback done) {
+        Request* request = new Request();
+        request->kind = op.type == OperationType::Deposit ? Request::Kind::Deposit
+            : op.type == OperationType::Withdraw ? Request::Kind::Withdraw : Request::Kind::Transfer;
+        request->account = op.account;
+        request->toAccount = op.toAccount;
+        request->amount = op.amount;
+        request->done = std::move(done);
+        return request;
+    }
+
+    // Chạy fn(shard, i) trên luồng của từng phân mảnh và đợi tất cả xong
+    void forEachShard(const std::function<void(Shard&, size_t)>& fn) {
+        std::vector<std::promise<void>> finished(shards.size());
+        for (size_t i = 0; i < shards.size(); ++i) {
+            Request* request = new Request();
+            request->task = [&fn, &finished, i](Shard& shard) {
+                fn(shard, i);
+                finished[i].set_value();
+            };
+            ++outstanding;
+            send(*shards[i], request);
+        }
+        for (auto& done : finished) {
+            done.get_future().wait();
+        }
+    }
 
 public:
-    void addAccount(Account* account) {
-        accounts.emplace_back(account);
+    explicit ShardedBank(size_t shardCount = std::thread::hardware_concurrency()) {
+        shards.resize(std::max<size_t>(1, shardCount));
+        for (auto& shard : shards) {
+            shard.reset(new Shard());
+        }
+        for (auto& shard : shards) {
+            Shard* owned = shard.get();
+            shard->worker = std::thread([this, owned] { run(*owned); });
+        }
+    }
+
+    ShardedBank(const ShardedBank&) = delete;
+    ShardedBank& operator=(const ShardedBank&) = delete;
+
+    size_t shardCount() const {
+        return shards.size();
     }
 
-    Account* findAccount(const std::string& number) {
-        for (auto& account : accounts) {
-            if (account->getAccountNumber() == number) {
-                return account;
+    // Trả về false nếu số tài khoản đã tồn tại; khi đó người gọi vẫn sở hữu account
+    bool addAccount(Account* account) {
+        std::promise<bool> added;
+        Request* request = new Request();
+        request->account = account->getAccountNumber();
+        request->task = [account, &added](Shard& shard) {
+            const bool inserted = shard.index.insert(account);
+            if (inserted) {
+                shard.accounts.push_back(account);
             }
+            added.set_value(inserted);
+        };
+        std::future<bool> result = added.get_future();
+        submit(request);
+        return result.get();
+    }
+
+    // Gửi thao tác và trả về ngay; done (có thể rỗng) được gọi trên luồng của phân mảnh
+    // xử lý bước cuối, nên không được chặn lâu
+    void submit(const Operation& op, Callback done = Callback()) {
+        OperationResult invalid = OperationResult::Ok;
+        if (op.amount <= Money()) {
+            invalid = OperationResult::InvalidAmount;
         }
-        std::cout << "Khong tim thay tai khoan." << std::endl;
-        return nullptr;
+        else if (op.type == OperationType::Transfer && op.account == op.toAccount) {
+            invalid = OperationResult::SameAccount;
+        }
+        if (invalid != OperationResult::Ok) {
+            if (done) {
+                done(invalid);
+            }
+            return;
+        }
+        submit(operationRequest(op, std::move(done)));
     }
 
-    void displayAllAccounts() const {
-        for (const auto& account : accounts) {
-            account->displayInfo();
-            std::cout << "------------------------" << std::endl;
+    // Gửi rồi đợi kết quả
+    OperationResult execute(const Operation& op) {
+        std::promise<OperationResult> result;
+        std::future<OperationResult> future = result.get_future();
+        submit(op, [&result](OperationResult r) { result.set_value(r); });
+        return future.get();
+    }
+
+    // Đợi mọi yêu cầu đã gửi hoàn tất, kể cả pha cộng tiền của chuyển tiền liên phân mảnh
+    void drain() {
+        std::unique_lock<std::mutex> lock(drainMutex);
+        drained.wait(lock, [this] { return outstanding.load() == 0; });
+    }
+
+    // Đợi hết yêu cầu rồi cộng số dư (kể cả tiền hoàn đang chờ) trên luồng của từng phân mảnh
+    Money totalBalance() {
+        drain();
+        std::vector<Money> totals(shards.size());
+        forEachShard([&totals](Shard& shard, size_t i) {
+            for (const auto& account : shard.accounts) {
+                totals[i] += account->getBalance();
+            }
+            for (const auto& refund : shard.pendingRefunds) {
+                totals[i] += refund.second;
+            }
+        });
+        Money total;
+        for (Money subtotal : totals) {
+            total += subtotal;
         }
+        return total;
     }
 
-    ~Bank() {
-        for (auto account : accounts) {
-            delete account;
+    ~ShardedBank() {
+        drain();
+        stopping.store(true);
+        for (auto& shard : shards) {
+            {
+                std::lock_guard<std::mutex> lock(shard->parkMutex);
+                shard->wake.notify_one();
+            }
+            shard->worker.join();
+        }
+        for (auto& shard : shards) {
+            for (auto account : shard->accounts) {
+                delete account;
+            }
         }
     }
 };
 
+// Biên dịch với -DBANK_NO_MAIN để dùng file này như thư viện (xem bench/)
+#ifndef BANK_NO_MAIN
+// Tách dòng lệnh thành các từ, bỏ qua khoảng trắng thừa
+static void splitWords(std::string_view line, std::vector<std::string_view>& words) {
+    words.clear();
+    size_t pos = 0;
+    while (true) {
+        pos = line.find_first_not_of(" \t\r", pos);
+        if (pos == std::string_view::npos) {
+            return;
+        }
+        const size_t end = std::min(line.find_first_of(" \t\r", pos), line.size());
+        words.push_back(line.substr(pos, end - pos));
+        pos = end;
+    }
+}
+
+static bool parseInt(std::string_view word, int& value) {
+    auto result = std::from_chars(word.data(), word.data() + word.size(), value);
+    return result.ec == std::errc() && result.ptr == word.data() + word.size();
+}
+
+// Lý do lỗi in ra ở chế độ batch; chuỗi rỗng khi thành công
+static std::string operationError(OperationResult result) {
+    switch (result) {
+    case OperationResult::Ok:
+        return "";
+    case OperationResult::AccountNotFound:
+        return "not-found";
+    case OperationResult::LogFailure:
+        return "io";
+    default:
+        return "rejected";
+    }
+}
+
+// Chế độ không tương tác: mỗi dòng một lệnh, không in lời nhắc, mỗi lệnh in đúng một dòng
+// kết quả "<số dòng> OK ..." hoặc "<số dòng> ERR <lý do>". Dòng trống và dòng bắt đầu bằng '#'
+// được bỏ qua. Các lệnh:
+//   savings <số tk> <chủ tk> <số dư> <lãi suất tháng>
+//   fixed <số tk> <chủ tk> <số dư> <lãi suất tháng> <kỳ hạn (tháng)>
+//   deposit <số tk> <số tiền>        withdraw <số tk> <số tiền>
+//   transfer <từ tk> <đến tk> <số tiền>
+//   find <số tk>    monthly-interest (tính lãi một tháng)    total    checkpoint
+//   metrics  (in số liệu đo thao tác Bank dạng JSON trên cùng dòng)
+//   export <file>    import <file>  (snapshot nhị phân; import in số tài khoản đã nạp)
+// Mặc định mỗi lệnh gọi đúng hàm Bank mà chương trình tương tác gọi (deposit/withdraw/transfer
+// đợi fsync từng lệnh), nên phát lại cho cùng kết quả. Với groupCommit, các lệnh deposit/withdraw/
+// transfer liên tiếp (tối đa BATCH_WINDOW lệnh) được gom lại và chạy bằng một lần processBatch, cả
+// nhóm chỉ đợi một lần fsync; kết quả vẫn in theo thứ tự dòng, nhưng thứ tự áp dụng giữa các nhóm tài
+// khoản, thứ tự ưu tiên lỗi và số đo theo processBatch.
+// Thông lượng và phân vị độ trễ được ghi ra stats khi kết thúc; với groupCommit, độ trễ của lệnh gom
+// tính cả thời gian chờ đủ nhóm.
+static void runBatch(Bank& bank, std::istream& in, std::ostream& out, std::ostream& stats,
+    const std::string& snapshotPath, bool groupCommit) {
+    const size_t BATCH_WINDOW = 4096;
+    BatchStats batch;
+    std::vector<std::string_view> words;
+    std::string line;
+    size_t lineNumber = 0;
+    std::vector<Operation> pending;
+    std::vector<size_t> pendingLines;
+    std::vector<std::chrono::steady_clock::time_point> pendingStarted;
+    auto flushPending = [&] {
+        if (pending.empty()) {
+            return;
+        }
+        const std::vector<OperationResult> results = bank.processBatch(pending);
+        const auto finished = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pending.size(); ++i) {
+            out << pendingLines[i];
+            const std::string error = operationError(results[i]);
+            if (!error.empty()) {
+                out << " ERR " << error << '\n';
+                ++batch.failed;
+            }
+            else {
+                out << " OK\n";
+            }
+            batch.latencies.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                finished - pendingStarted[i]).count()));
+        }
+        pending.clear();
+        pendingLines.clear();
+        pendingStarted.clear();
+    };
+    const auto started = std::chrono::steady_clock::now();
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        splitWords(line, words);
+        if (words.empty() || words[0][0] == '#') {
+            continue;
+        }
+        const auto commandStarted = std::chrono::steady_clock::now();
+        const std::string_view command = words[0];
+        std::string error;
+        Money amount;
+        Money balance;
+        Rate rate;
+        int term = 0;
+        const bool money = ((command == "deposit" || command == "withdraw") && words.size() == 3) ||
+            (command == "transfer" && words.size() == 4);
+        const bool validAmount = money && Money::parse(words.back(), amount) && amount > Money();
+        if (validAmount && groupCommit) {
+            Operation op;
+            op.type = command == "deposit" ? OperationType::Deposit
+                : command == "withdraw" ? OperationType::Withdraw : OperationType::Transfer;
+            op.account = std::string(words[1]);
+            if (op.type == OperationType::Transfer) {
+                op.toAccount = std::string(words[2]);
+            }
+            op.amount = amount;
+            pending.push_back(std::move(op));
+            pendingLines.push_back(lineNumber);
+            pendingStarted.push_back(commandStarted);
+            if (pending.size() == BATCH_WINDOW) {
+                flushPending();
+            }
+            continue;
+        }
+        flushPending();
+        out << lineNumber;
+        if (money && !validAmount) {
+            error = "invalid-amount";
+        }
+        else if (money && words.size() == 3) {
+            error = operationError(command == "deposit" ? bank.deposit(words[1], amount)
+                : bank.withdraw(words[1], amount));
+        }
+        else if (money) {
+            error = operationError(bank.transfer(words[1], words[2], amount));
+        }
+        else if ((command == "savings" && words.size() == 5) || (command == "fixed" && words.size() == 6)) {
+            if (!Money::parse(words[3], balance) || balance < Money() || !Rate::parse(words[4], rate) ||
+                (words.size() == 6 && !parseInt(words[5], term))) {
+                error = "invalid-argument";
+            }
+            else {
+                const std::string number(words[1]), owner(words[2]);
+                Account* account = words.size() == 5 ? static_cast<Account*>(new SavingsAccount(number, owner, balance, rate))
+                    : new FixedDepositAccount(number, owner, balance, rate, term);
+                if (!bank.addAccount(account)) {
+                    delete account;
+                    error = "duplicate";
+                }
+            }
+        }
+        else if (command == "find" && words.size() == 2) {
+            if (Account* account = bank.findAccount(words[1])) {
+                out << " OK " << account->getBalance() << '\n';
+            }
+            else {
+                error = "not-found";
+            }
+        }
+        else if (command == "monthly-interest" && words.size() == 1) {
+            Money total;
+            if (bank.accrueMonthlyInterest(total)) {
+                out << " OK " << total << '\n';
+            }
+            else {
+                error = "io";
+            }
+        }
+        else if (command == "total" && words.size() == 1) {
+            out << " OK " << bank.totalBalance() << '\n';
+        }
+        else if (command == "metrics" && words.size() == 1) {
+#ifndef BANK_NO_METRICS
+            out << " OK " << BankMetrics::instance().snapshot().toJson() << '\n';
+#else
+            error = "metrics-disabled";
+#endif
+        }
+        else if (command == "export" && words.size() == 2) {
+            if (!bank.exportSnapshot(std::string(words[1]))) {
+                error = "io";
+            }
+        }
+        else if (command == "import" && words.size() == 2) {
+            size_t imported = 0;
+            if (bank.importSnapshot(std::string(words[1]), imported)) {
+                out << " OK " << imported << '\n';
+            }
+            else {
+                error = "io";
+            }
+        }
+        else if (command == "checkpoint" && words.size() == 1) {
+            if (!bank.checkpoint(snapshotPath)) {
+                error = "io";
+            }
+        }
+        else {
+            error = "unknown-command";
+        }
+        if (!error.empty()) {
+            out << " ERR " << error << '\n';
+            ++batch.failed;
+        }
+        else if (command != "find" && command != "monthly-interest" && command != "total" && command != "metrics" &&
+            command != "import") {
+            out << " OK\n";
+        }
+        batch.latencies.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - commandStarted).count()));
+    }
+    flushPending();
+    out.flush();
+    batch.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    batch.print(stats);
+#ifndef BANK_NO_METRICS
+    stats << BankMetrics::instance().snapshot().toText();
+#endif
+}
+
 void displayMenu() {
     std::cout << "=== MENU NGAN HANG ===" << std::endl;
     std::cout << "1. Them tai khoan tiet kiem" << std::endl;
@@ -137,11 +2244,47 @@ void displayMenu() {
     std::cout << "3. Chuyen tien" << std::endl;
     std::cout << "4. Tim tai khoan" << std::endl;
     std::cout << "5. Hien thi tat ca tai khoan" << std::endl;
+    std::cout << "6. Tinh lai hang thang" << std::endl;
+    std::cout << "7. Xuat snapshot" << std::endl;
+    std::cout << "8. Nhap snapshot" << std::endl;
     std::cout << "0. Thoat" << std::endl;
 }
 
-int main() {
+// Chạy "2 --batch [--group] [file]" để đọc lệnh từ file (hoặc stdin nếu không có file);
+// --group bật gom nhóm lệnh nạp/rút/chuyển (xem runBatch)
+int main(int argc, char* argv[]) {
+    const std::string snapshotPath = "bank.snapshot";
+    const std::string logPath = "bank.wal";
+    const uint64_t checkpointLogSize = 64 << 20;
+
     Bank myBank;
+    // Dừng hẳn nếu không khôi phục được, để checkpoint lúc thoát không ghi đè dữ liệu cũ
+    if (!myBank.recover(snapshotPath, logPath)) {
+        std::cout << "Khong the khoi phuc du lieu hoac mo nhat ky giao dich." << std::endl;
+        return 1;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        std::ios::sync_with_stdio(false);
+        const bool groupCommit = argc > 2 && std::string(argv[2]) == "--group";
+        const int fileArg = groupCommit ? 3 : 2;
+        if (argc > fileArg) {
+            std::ifstream file(argv[fileArg]);
+            if (!file) {
+                std::cout << "Khong the mo file lenh." << std::endl;
+                return 1;
+            }
+            runBatch(myBank, file, std::cout, std::cerr, snapshotPath, groupCommit);
+        }
+        else {
+            runBatch(myBank, std::cin, std::cout, std::cerr, snapshotPath, groupCommit);
+        }
+        if (!myBank.checkpoint(snapshotPath)) {
+            std::cout << "Khong the ghi snapshot hoac xoa nhat ky giao dich." << std::endl;
+            return 1;
+        }
+        return 0;
+    }
     int choice;
 
     do {
@@ -152,21 +2295,27 @@ int main() {
         switch (choice) {
         case 1: {
             std::string number, name;
-            double balance, rate;
+            Money balance;
+            Rate rate;
             std::cout << "Nhap so tai khoan: ";
             std::cin >> number;
             std::cout << "Nhap ten chu tai khoan: ";
             std::cin >> name;
             std::cout << "Nhap so du: ";
             std::cin >> balance;
-            std::cout << "Nhap lai suat: ";
+            std::cout << "Nhap lai suat thang: ";
             std::cin >> rate;
-            myBank.addAccount(new SavingsAccount(number, name, balance, rate));
+            Account* account = new SavingsAccount(number, name, balance, rate);
+            if (!myBank.addAccount(account)) {
+                delete account;
+                std::cout << "So tai khoan da ton tai." << std::endl;
+            }
             break;
         }
         case 2: {
             std::string number, name;
-            double balance, rate;
+            Money balance;
+            Rate rate;
             int term;
             std::cout << "Nhap so tai khoan: ";
             std::cin >> number;
@@ -174,16 +2323,20 @@ int main() {
             std::cin >> name;
             std::cout << "Nhap so du: ";
             std::cin >> balance;
-            std::cout << "Nhap lai suat: ";
+            std::cout << "Nhap lai suat thang: ";
             std::cin >> rate;
             std::cout << "Nhap thoi han (thang): ";
             std::cin >> term;
-            myBank.addAccount(new FixedDepositAccount(number, name, balance, rate, term));
+            Account* account = new FixedDepositAccount(number, name, balance, rate, term);
+            if (!myBank.addAccount(account)) {
+                delete account;
+                std::cout << "So tai khoan da ton tai." << std::endl;
+            }
             break;
         }
         case 3: {
             std::string fromAccount, toAccount;
-            double amount;
+            Money amount;
             std::cout << "Nhap so tai khoan chuyen tu: ";
             std::cin >> fromAccount;
             std::cout << "Nhap so tai khoan chuyen den: ";
@@ -191,11 +2344,20 @@ int main() {
             std::cout << "Nhap so tien chuyen: ";
             std::cin >> amount;
 
-            Account* fromAcc = myBank.findAccount(fromAccount);
-            Account* toAcc = myBank.findAccount(toAccount);
-
-            if (fromAcc && toAcc) {
-                fromAcc->transfer(toAcc, amount);
+            switch (myBank.transfer(fromAccount, toAccount, amount)) {
+            case OperationResult::Ok:
+                std::cout << "Da chuyen " << amount << " tu tai khoan " << fromAccount
+                    << " den tai khoan " << toAccount << "." << std::endl;
+                break;
+            case OperationResult::AccountNotFound:
+                std::cout << "Khong tim thay tai khoan." << std::endl;
+                break;
+            case OperationResult::LogFailure:
+                std::cout << "Khong the ghi nhat ky giao dich." << std::endl;
+                break;
+            default:
+                std::cout << "Khong the chuyen tien. So du khong du hoac so tien khong hop le." << std::endl;
+                break;
             }
             break;
         }
@@ -203,20 +2365,65 @@ int main() {
             std::string number;
             std::cout << "Nhap so tai khoan can tim: ";
             std::cin >> number;
-            myBank.findAccount(number);
+            if (!myBank.findAccount(number)) {
+                std::cout << "Khong tim thay tai khoan." << std::endl;
+            }
             break;
         }
         case 5:
             myBank.displayAllAccounts();
             break;
+        case 6: {
+            Money total;
+            if (myBank.accrueMonthlyInterest(total)) {
+                std::cout << "Tong tien lai: " << total << std::endl;
+            }
+            else {
+                std::cout << "Khong the ghi nhat ky giao dich." << std::endl;
+            }
+            break;
+        }
+        case 7: {
+            std::string path;
+            std::cout << "Nhap ten file: ";
+            std::cin >> path;
+            if (myBank.exportSnapshot(path)) {
+                std::cout << "Da xuat snapshot." << std::endl;
+            }
+            else {
+                std::cout << "Khong the ghi file." << std::endl;
+            }
+            break;
+        }
+        case 8: {
+            std::string path;
+            size_t imported = 0;
+            std::cout << "Nhap ten file: ";
+            std::cin >> path;
+            if (myBank.importSnapshot(path, imported)) {
+                std::cout << "Da nap " << imported << " tai khoan." << std::endl;
+            }
+            else {
+                std::cout << "Khong the doc snapshot." << std::endl;
+            }
+            break;
+        }
         case 0:
+            if (!myBank.checkpoint(snapshotPath)) {
+                std::cout << "Khong the ghi snapshot hoac xoa nhat ky giao dich." << std::endl;
+            }
             std::cout << "Cam on ban da su dung dich vu!" << std::endl;
             break;
         default:
             std::cout << "Lua chon khong hop le. Vui long nhap lai!" << std::endl;
         }
 
+        if (myBank.logSize() > checkpointLogSize && !myBank.checkpoint(snapshotPath)) {
+            std::cout << "Khong the ghi snapshot hoac xoa nhat ky giao dich." << std::endl;
+        }
+
     } while (choice != 0);
 
     return 0;
 }
+#endif
@@ -4,42 +4,131 @@
 #include <algorithm>
 #include <fstream>
 #include <stdexcept>
+#include <chrono>
+#include <cstdint>
+#include <cctype>
+#include <string_view>
+#include <unordered_map>
+#include <array>
+#include <cstring>
+#include <random>
+#include <atomic>
+#include <charconv>
+#include <set>
+#include <iterator>
+#include <cstdio>
+#include <utility>
 
+#include "fileio.h"
+#include "batch_stats.h"
+
+enum class BorrowResult {
+    Success,
+    AlreadyBorrowed, // Tài liệu đang được người khác (hoặc chính người này) mượn
+    NotBorrowed,     // Trả tài liệu chưa được mượn
+    NotHolder        // Trả tài liệu do người khác mượn
+};
+
+// Trạng thái mượn nằm trong một biến atomic 64 bit: 32 bit cao là id người mượn, 32 bit thấp
+// là thời điểm mượn (giây Unix); 0 nghĩa là chưa ai mượn. Mượn/trả bằng compare-and-swap nên
+// nhiều luồng có thể mượn/trả cùng lúc mà không mất cập nhật, người mượn và thời điểm luôn khớp nhau.
+// version tăng sau mỗi lần đổi trạng thái, để lần lưu sau chỉ ghi tài liệu đã thay đổi.
 class Borrowable {
 protected:
     std::string title;
     std::string author;
-    bool isBorrowed;
+    std::atomic<uint64_t> loan;
+    std::atomic<uint32_t> version;
+
+    static uint64_t packLoan(uint32_t holder, uint32_t loanedAt) {
+        return (uint64_t(holder) << 32) | loanedAt;
+    }
 
 public:
-    Borrowable(const std::string& title, const std::string& author)
-        : title(title), author(author), isBorrowed(false) {}
+    // Người mượn không rõ: dữ liệu cũ không ghi username người mượn (chỉ có cờ "đã mượn" hoặc id
+    // của phiên trước). Không người dùng nào có id này; chỉ forceReturn trả được.
+    static const uint32_t UNKNOWN_HOLDER = 0xFFFFFFFF;
+
+    Borrowable(std::string title, std::string author)
+        : title(std::move(title)), author(std::move(author)), loan(0), version(0) {}
 
-    virtual void borrow() {
-        if (isBorrowed) {
-            throw std::runtime_error("Tai lieu da duoc muon.");
+    // holder phải khác 0
+    BorrowResult borrow(uint32_t holder) {
+        const auto now = std::chrono::system_clock::now().time_since_epoch();
+        const uint32_t seconds = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+        uint64_t expected = 0;
+        if (!loan.compare_exchange_strong(expected, packLoan(holder, seconds), std::memory_order_acq_rel)) {
+            return BorrowResult::AlreadyBorrowed;
         }
-        isBorrowed = true;
-        std::cout << "Da muon tai lieu: " << title << std::endl;
+        version.fetch_add(1, std::memory_order_release);
+        return BorrowResult::Success;
     }
 
-    virtual void returnItem() {
-        if (!isBorrowed) {
-            throw std::runtime_error("Tai lieu chua duoc muon.");
+    // Chỉ người đang mượn mới trả được
+    BorrowResult returnItem(uint32_t holder) {
+        uint64_t current = loan.load(std::memory_order_acquire);
+        while (true) {
+            if (current == 0) {
+                return BorrowResult::NotBorrowed;
+            }
+            if (current >> 32 != holder) {
+                return BorrowResult::NotHolder;
+            }
+            if (loan.compare_exchange_weak(current, 0, std::memory_order_acq_rel)) {
+                version.fetch_add(1, std::memory_order_release);
+                return BorrowResult::Success;
+            }
         }
-        isBorrowed = false;
-        std::cout << "Da tra tai lieu: " << title << std::endl;
     }
 
+    // Thủ thư thu hồi tài liệu, bất kể ai đang mượn
+    BorrowResult forceReturn() {
+        if (loan.exchange(0, std::memory_order_acq_rel) == 0) {
+            return BorrowResult::NotBorrowed;
+        }
+        version.fetch_add(1, std::memory_order_release);
+        return BorrowResult::Success;
+    }
+
+    // Khôi phục trạng thái mượn khi nạp dữ liệu, không kiểm tra
+    void restoreLoan(uint32_t holder, uint32_t loanedAt) {
+        loan.store(holder == 0 ? 0 : packLoan(holder, loanedAt), std::memory_order_release);
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    // Ký hiệu loại tài liệu trong file dữ liệu
+    virtual char typeTag() const = 0;
+
     virtual void displayInfo() const {
         std::cout << "Tieu de: " << title << ", Tac gia: " << author
-            << ", Da muon: " << (isBorrowed ? "Co" : "Khong") << std::endl;
+            << ", Da muon: " << (getIsBorrowed() ? "Co" : "Khong") << std::endl;
     }
 
     virtual ~Borrowable() = default;
 
     bool getIsBorrowed() const {
-        return isBorrowed;
+        return loan.load(std::memory_order_acquire) != 0;
+    }
+
+    // 0 nếu chưa ai mượn
+    uint32_t getHolder() const {
+        return static_cast<uint32_t>(loan.load(std::memory_order_acquire) >> 32);
+    }
+
+    // Thời điểm mượn (giây Unix); chỉ có nghĩa khi getHolder() != 0
+    uint32_t getLoanedAt() const {
+        return static_cast<uint32_t>(loan.load(std::memory_order_acquire));
+    }
+
+    // Người mượn và thời điểm đọc cùng một lần, luôn khớp nhau
+    void getLoan(uint32_t& holder, uint32_t& loanedAt) const {
+        const uint64_t current = loan.load(std::memory_order_acquire);
+        holder = static_cast<uint32_t>(current >> 32);
+        loanedAt = static_cast<uint32_t>(current);
+    }
+
+    uint32_t getVersion() const {
+        return version.load(std::memory_order_acquire);
     }
 
     const std::string& getTitle() const {
@@ -53,97 +142,1085 @@ public:
 
 class Magazine : public Borrowable {
 public:
-    Magazine(const std::string& title, const std::string& author)
-        : Borrowable(title, author) {}
+    static const char TYPE_TAG = 'M';
+
+    Magazine(std::string title, std::string author)
+        : Borrowable(std::move(title), std::move(author)) {}
+
+    char typeTag() const override {
+        return TYPE_TAG;
+    }
 };
 
+// SHA-256 (FIPS 180-4), dùng làm hàm băm nền cho băm mật khẩu
+class Sha256 {
+private:
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    uint8_t block[64];
+    size_t blockSize = 0;
+    uint64_t totalBytes = 0;
+
+    static uint32_t rotr(uint32_t x, int n) {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    void compress(const uint8_t* data) {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(data[4 * i]) << 24) | (uint32_t(data[4 * i + 1]) << 16) |
+                (uint32_t(data[4 * i + 2]) << 8) | data[4 * i + 3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+
+public:
+    static const size_t DIGEST_SIZE = 32;
+    using Digest = std::array<uint8_t, DIGEST_SIZE>;
+
+    Sha256& update(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        totalBytes += size;
+        while (size > 0) {
+            const size_t take = std::min(size, sizeof block - blockSize);
+            std::memcpy(block + blockSize, bytes, take);
+            blockSize += take;
+            bytes += take;
+            size -= take;
+            if (blockSize == sizeof block) {
+                compress(block);
+                blockSize = 0;
+            }
+        }
+        return *this;
+    }
+
+    // Số nguyên 64 bit, ghi little-endian
+    Sha256& update(uint64_t value) {
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+        return update(bytes, sizeof bytes);
+    }
+
+    Digest finish() {
+        const uint64_t bits = totalBytes * 8;
+        const uint8_t pad = 0x80;
+        const uint8_t zero = 0;
+        update(&pad, 1);
+        while (blockSize != 56) {
+            update(&zero, 1);
+        }
+        uint8_t length[8];
+        for (int i = 0; i < 8; ++i) {
+            length[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        }
+        update(length, sizeof length);
+        Digest digest;
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                digest[4 * i + j] = static_cast<uint8_t>(state[i] >> (24 - 8 * j));
+            }
+        }
+        return digest;
+    }
+};
+
+// Chi phí băm mật khẩu: memoryBlocks khối 32 byte (bộ nhớ cần giữ) và rounds lượt trộn.
+// Tăng một trong hai để làm chậm dò mật khẩu, đổi lại mỗi lần đăng nhập tốn CPU hơn.
+struct PasswordCost {
+    uint32_t memoryBlocks = 1024; // 32 KiB
+    uint32_t rounds = 2;
+
+    bool operator==(const PasswordCost& other) const {
+        return memoryBlocks == other.memoryBlocks && rounds == other.rounds;
+    }
+
+    bool operator!=(const PasswordCost& other) const {
+        return !(*this == other);
+    }
+};
+
+// Băm mật khẩu kiểu Balloon (Boneh, Corrigan-Gibbs, Schechter 2016) trên SHA-256: cần giữ
+// toàn bộ bộ đệm memoryBlocks khối trong bộ nhớ, mỗi khối trộn với DELTA khối chọn giả ngẫu nhiên.
+class PasswordHasher {
+private:
+    static const uint32_t DELTA = 3;
+
+public:
+    static const size_t SALT_SIZE = 16;
+    using Salt = std::array<uint8_t, SALT_SIZE>;
+
+    static Salt randomSalt() {
+        static std::random_device device;
+        Salt salt;
+        for (size_t i = 0; i < SALT_SIZE; i += 4) {
+            const uint32_t value = device();
+            std::memcpy(salt.data() + i, &value, std::min<size_t>(4, SALT_SIZE - i));
+        }
+        return salt;
+    }
+
+    static Sha256::Digest hash(const std::string& password, const Salt& salt, PasswordCost cost) {
+        const uint32_t blocks = std::max<uint32_t>(cost.memoryBlocks, 1);
+        std::vector<Sha256::Digest> buffer(blocks);
+        uint64_t counter = 0;
+        buffer[0] = Sha256().update(counter++).update(password.data(), password.size())
+            .update(salt.data(), salt.size()).finish();
+        for (uint32_t m = 1; m < blocks; ++m) {
+            buffer[m] = Sha256().update(counter++).update(buffer[m - 1].data(), Sha256::DIGEST_SIZE).finish();
+        }
+        for (uint32_t round = 0; round < cost.rounds; ++round) {
+            for (uint32_t m = 0; m < blocks; ++m) {
+                const Sha256::Digest& previous = buffer[(m + blocks - 1) % blocks];
+                buffer[m] = Sha256().update(counter++).update(previous.data(), Sha256::DIGEST_SIZE)
+                    .update(buffer[m].data(), Sha256::DIGEST_SIZE).finish();
+                for (uint32_t i = 0; i < DELTA; ++i) {
+                    const Sha256::Digest index = Sha256().update(round).update(m).update(i).finish();
+                    const Sha256::Digest pick = Sha256().update(counter++).update(salt.data(), salt.size())
+                        .update(index.data(), Sha256::DIGEST_SIZE).finish();
+                    uint64_t other = 0;
+                    for (int b = 7; b >= 0; --b) {
+                        other = (other << 8) | pick[b];
+                    }
+                    buffer[m] = Sha256().update(counter++).update(buffer[m].data(), Sha256::DIGEST_SIZE)
+                        .update(buffer[other % blocks].data(), Sha256::DIGEST_SIZE).finish();
+                }
+            }
+        }
+        return buffer[blocks - 1];
+    }
+
+    // So sánh không rẽ nhánh theo dữ liệu để thời gian không lộ số byte khớp
+    static bool equal(const Sha256::Digest& a, const Sha256::Digest& b) {
+        uint8_t difference = 0;
+        for (size_t i = 0; i < Sha256::DIGEST_SIZE; ++i) {
+            difference |= a[i] ^ b[i];
+        }
+        return difference == 0;
+    }
+};
+
+// Người dùng chỉ giữ muối và giá trị băm của mật khẩu, không giữ mật khẩu gốc.
+// id (khác 0) là mã người mượn ghi trên tài liệu.
 class User {
 private:
+    uint32_t id;
     std::string username;
-    std::string password;
+    PasswordHasher::Salt salt;
+    Sha256::Digest passwordHash;
+    PasswordCost cost;
 
 public:
-    User(const std::string& username, const std::string& password)
-        : username(username), password(password) {}
+    User(uint32_t id, const std::string& username, const std::string& password, PasswordCost cost = PasswordCost())
+        : id(id), username(username), salt(PasswordHasher::randomSalt()),
+        passwordHash(PasswordHasher::hash(password, salt, cost)), cost(cost) {}
+
+    uint32_t getId() const {
+        return id;
+    }
 
     const std::string& getUsername() const {
         return username;
     }
 
+    PasswordCost getCost() const {
+        return cost;
+    }
+
     bool validatePassword(const std::string& pass) const {
-        return password == pass;
+        return PasswordHasher::equal(PasswordHasher::hash(pass, salt, cost), passwordHash);
+    }
+
+    // Băm lại mật khẩu (đã kiểm tra đúng) với muối mới theo chi phí mới
+    void rehash(const std::string& password, PasswordCost newCost) {
+        salt = PasswordHasher::randomSalt();
+        passwordHash = PasswordHasher::hash(password, salt, newCost);
+        cost = newCost;
+    }
+};
+
+enum class LoginResult {
+    Success,
+    InvalidCredentials, // Sai username hoặc mật khẩu (không phân biệt để tránh dò username)
+    RateLimited         // Sai quá nhiều lần, tài khoản đang tạm khoá
+};
+
+// Chữ cái tiếng Việt có dấu, nhóm theo chữ cái gốc (ký tự đầu mỗi nhóm)
+static const char* const VIETNAMESE_LETTERS[] = {
+    "aàáảãạăằắẳẵặâầấẩẫậAÀÁẢÃẠĂẰẮẲẴẶÂẦẤẨẪẬ",
+    "eèéẻẽẹêềếểễệEÈÉẺẼẸÊỀẾỂỄỆ",
+    "iìíỉĩịIÌÍỈĨỊ",
+    "oòóỏõọôồốổỗộơờớởỡợOÒÓỎÕỌÔỒỐỔỖỘƠỜỚỞỠỢ",
+    "uùúủũụưừứửữựUÙÚỦŨỤƯỪỨỬỮỰ",
+    "yỳýỷỹỵYỲÝỶỸỴ",
+    "dđDĐ"
+};
+
+// Giải mã một ký tự UTF-8 tại pos; byte không hợp lệ được trả về nguyên giá trị, length = 1
+static uint32_t decodeUtf8(std::string_view text, size_t pos, size_t& length) {
+    const unsigned char lead = static_cast<unsigned char>(text[pos]);
+    length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+    if (length == 0 || pos + length > text.size()) {
+        length = 1;
+        return lead;
+    }
+    uint32_t code = length == 1 ? lead : lead & (0x7F >> length);
+    for (size_t i = 1; i < length; ++i) {
+        const unsigned char next = static_cast<unsigned char>(text[pos + i]);
+        if ((next >> 6) != 0x2) {
+            length = 1;
+            return lead;
+        }
+        code = (code << 6) | (next & 0x3F);
+    }
+    return code;
+}
+
+// Bỏ dấu tiếng Việt và chuyển chữ ASCII về chữ thường: "Lập Trình" -> "lap trinh".
+// Dấu tổ hợp (U+0300..U+036F) bị bỏ; ký tự khác giữ nguyên.
+static std::string foldText(std::string_view text) {
+    static const std::unordered_map<uint32_t, char> folded = [] {
+        std::unordered_map<uint32_t, char> map;
+        for (const char* group : VIETNAMESE_LETTERS) {
+            const std::string_view letters(group);
+            const char base = letters[0];
+            for (size_t pos = 0, length = 0; pos < letters.size(); pos += length) {
+                map[decodeUtf8(letters, pos, length)] = base;
+            }
+        }
+        return map;
+    }();
+    std::string out;
+    out.reserve(text.size());
+    for (size_t pos = 0, length = 0; pos < text.size(); pos += length) {
+        // Đường nhanh cho ASCII, không cần giải mã
+        const char c = text[pos];
+        if (static_cast<unsigned char>(c) < 0x80) {
+            out += c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+            length = 1;
+            continue;
+        }
+        const uint32_t code = decodeUtf8(text, pos, length);
+        if (code >= 0x300 && code <= 0x36F) {
+            continue;
+        }
+        auto found = folded.find(code);
+        if (found != folded.end()) {
+            out += found->second;
+        }
+        else {
+            out.append(text.data() + pos, length);
+        }
+    }
+    return out;
+}
+
+// Chỉ mục tìm kiếm cho tiêu đề và tác giả: chỉ mục ngược từ -> tài liệu, cộng chỉ mục
+// trigram trên tập từ để tìm được cả chuỗi con của từ. Từ được bỏ dấu trước khi đánh chỉ mục,
+// nên tìm "lap trinh" thấy "Lập trình". Tài liệu được thêm theo id tăng dần.
+class CatalogIndex {
+private:
+    static const uint8_t TITLE = 1;
+    static const uint8_t AUTHOR = 2;
+
+    struct Posting {
+        uint32_t item;
+        uint8_t fields; // TITLE | AUTHOR
+    };
+
+    std::unordered_map<std::string, uint32_t> tokenIds;
+    std::vector<std::string> vocabulary;
+    std::vector<std::vector<Posting>> postings;                     // Theo id của từ
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;   // Trigram -> id các từ chứa nó
+    size_t itemCount = 0;
+    std::string lookupKey;                                          // Bộ đệm khoá tìm kiếm, tránh cấp phát
+
+    static uint32_t trigramAt(std::string_view token, size_t pos) {
+        return (uint32_t(uint8_t(token[pos])) << 16) | (uint32_t(uint8_t(token[pos + 1])) << 8) | uint8_t(token[pos + 2]);
+    }
+
+    // Từ là chuỗi liên tiếp chữ/số ASCII hoặc byte UTF-8 chưa bỏ dấu được
+    static void tokenize(std::string_view folded, std::vector<std::string_view>& out) {
+        out.clear();
+        size_t start = 0;
+        for (size_t pos = 0; pos <= folded.size(); ++pos) {
+            const bool wordChar = pos < folded.size() &&
+                (std::isalnum(static_cast<unsigned char>(folded[pos])) || static_cast<unsigned char>(folded[pos]) >= 0x80);
+            if (!wordChar) {
+                if (pos > start) {
+                    out.push_back(folded.substr(start, pos - start));
+                }
+                start = pos + 1;
+            }
+        }
+    }
+
+    // Tìm trước rồi mới chèn: emplace luôn cấp phát một nút kể cả khi từ đã có
+    uint32_t internToken(std::string_view token) {
+        lookupKey.assign(token.data(), token.size());
+        auto found = tokenIds.find(lookupKey);
+        if (found != tokenIds.end()) {
+            return found->second;
+        }
+        const uint32_t id = static_cast<uint32_t>(vocabulary.size());
+        tokenIds.emplace(lookupKey, id);
+        vocabulary.emplace_back(token);
+        postings.emplace_back();
+        for (size_t pos = 0; pos + 3 <= token.size(); ++pos) {
+            std::vector<uint32_t>& list = trigrams[trigramAt(token, pos)];
+            if (list.empty() || list.back() != id) {
+                list.push_back(id);
+            }
+        }
+        return id;
+    }
+
+    void addField(uint32_t item, const std::string& text, uint8_t field) {
+        std::vector<std::string_view> tokens;
+        const std::string folded = foldText(text);
+        tokenize(folded, tokens);
+        for (std::string_view token : tokens) {
+            std::vector<Posting>& list = postings[internToken(token)];
+            if (list.empty() || list.back().item != item) {
+                list.push_back({ item, field });
+            }
+            else {
+                list.back().fields |= field;
+            }
+        }
+    }
+
+    // Id các từ chứa term; term từ 3 ký tự trở lên dùng trigram hiếm nhất để lọc ứng viên
+    void matchingTokens(std::string_view term, std::vector<uint32_t>& out) const {
+        out.clear();
+        if (term.size() < 3) {
+            for (uint32_t id = 0; id < vocabulary.size(); ++id) {
+                if (vocabulary[id].find(term) != std::string::npos) {
+                    out.push_back(id);
+                }
+            }
+            return;
+        }
+        const std::vector<uint32_t>* rarest = nullptr;
+        for (size_t pos = 0; pos + 3 <= term.size(); ++pos) {
+            auto found = trigrams.find(trigramAt(term, pos));
+            if (found == trigrams.end()) {
+                return;
+            }
+            if (!rarest || found->second.size() < rarest->size()) {
+                rarest = &found->second;
+            }
+        }
+        for (uint32_t id : *rarest) {
+            if (vocabulary[id].find(term) != std::string::npos) {
+                out.push_back(id);
+            }
+        }
+    }
+
+public:
+    void add(size_t item, const std::string& title, const std::string& author) {
+        addField(static_cast<uint32_t>(item), title, TITLE);
+        addField(static_cast<uint32_t>(item), author, AUTHOR);
+        itemCount = std::max(itemCount, item + 1);
+    }
+
+    void clear() {
+        tokenIds.clear();
+        vocabulary.clear();
+        postings.clear();
+        trigrams.clear();
+        itemCount = 0;
+    }
+
+    // Id tài liệu chứa mọi từ của query (là từ hoặc chuỗi con của từ trong tiêu đề/tác giả),
+    // xếp theo điểm giảm dần rồi id tăng dần. Khớp trọn từ > khớp đầu từ > chuỗi con,
+    // khớp ở tiêu đề được gấp đôi điểm khớp ở tác giả. Query rỗng trả về mọi tài liệu.
+    std::vector<size_t> search(const std::string& query) const {
+        const std::string folded = foldText(query);
+        std::vector<std::string_view> terms;
+        tokenize(folded, terms);
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        std::vector<size_t> result;
+        if (terms.empty()) {
+            for (size_t item = 0; item < itemCount; ++item) {
+                result.push_back(item);
+            }
+            return result;
+        }
+
+        std::unordered_map<uint32_t, int> scores;
+        std::unordered_map<uint32_t, int> termScores;
+        std::vector<uint32_t> tokens;
+        for (size_t t = 0; t < terms.size(); ++t) {
+            termScores.clear();
+            matchingTokens(terms[t], tokens);
+            for (uint32_t id : tokens) {
+                const std::string& token = vocabulary[id];
+                const int weight = token == terms[t] ? 3 : token.compare(0, terms[t].size(), terms[t]) == 0 ? 2 : 1;
+                for (const Posting& posting : postings[id]) {
+                    if (t > 0 && !scores.count(posting.item)) {
+                        continue;
+                    }
+                    const int score = weight * (((posting.fields & TITLE) ? 2 : 0) + ((posting.fields & AUTHOR) ? 1 : 0));
+                    int& best = termScores[posting.item];
+                    best = std::max(best, score);
+                }
+            }
+            // Giữ tài liệu khớp mọi từ đã xét
+            if (t == 0) {
+                scores.swap(termScores);
+            }
+            else {
+                for (auto it = scores.begin(); it != scores.end();) {
+                    auto found = termScores.find(it->first);
+                    if (found == termScores.end()) {
+                        it = scores.erase(it);
+                    }
+                    else {
+                        it->second += found->second;
+                        ++it;
+                    }
+                }
+            }
+            if (scores.empty()) {
+                return result;
+            }
+        }
+        std::vector<std::pair<int, uint32_t>> ranked;
+        ranked.reserve(scores.size());
+        for (const auto& entry : scores) {
+            ranked.emplace_back(-entry.second, entry.first);
+        }
+        std::sort(ranked.begin(), ranked.end());
+        for (const auto& entry : ranked) {
+            result.push_back(entry.second);
+        }
+        return result;
+    }
+};
+
+// Vị trí duyệt danh mục theo thứ tự tiêu đề: khoá nằm trong [lower, upper) (upper rỗng là không
+// giới hạn), trang sau bắt đầu ngay sau phần tử cuối của trang trước.
+struct CatalogCursor {
+    std::string lower;
+    std::string upper;
+    std::string lastKey;
+    uint32_t lastId = 0;
+    bool started = false;
+    bool finished = false;
+};
+
+// Danh mục sắp theo tiêu đề, cập nhật dần khi thêm tài liệu thay vì sắp xếp lại cả danh sách.
+// Khoá so sánh (tiêu đề bỏ dấu, chữ thường) được tính một lần lúc thêm; tiêu đề trùng khoá xếp theo id.
+class SortedCatalog {
+private:
+    std::set<std::pair<std::string, uint32_t>> entries;
+
+public:
+    void add(size_t id, const std::string& title) {
+        entries.emplace(foldText(title), static_cast<uint32_t>(id));
+    }
+
+    // Thêm nhiều (khoá, id) một lần khi nạp file: sắp xếp trước rồi chèn với gợi ý cuối cây
+    void addAll(std::vector<std::pair<std::string, uint32_t>>& keys) {
+        std::sort(keys.begin(), keys.end());
+        for (auto& key : keys) {
+            entries.emplace_hint(entries.end(), std::move(key));
+        }
+    }
+
+    void clear() {
+        entries.clear();
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    static CatalogCursor all() {
+        return CatalogCursor();
+    }
+
+    // Tiêu đề bắt đầu bằng prefix (không phân biệt hoa thường và dấu)
+    static CatalogCursor withPrefix(const std::string& prefix) {
+        CatalogCursor cursor;
+        cursor.lower = foldText(prefix);
+        cursor.upper = cursor.lower;
+        // Chuỗi nhỏ nhất lớn hơn mọi chuỗi có tiền tố lower
+        while (!cursor.upper.empty() && static_cast<unsigned char>(cursor.upper.back()) == 0xFF) {
+            cursor.upper.pop_back();
+        }
+        if (!cursor.upper.empty()) {
+            cursor.upper.back() = static_cast<char>(static_cast<unsigned char>(cursor.upper.back()) + 1);
+        }
+        return cursor;
+    }
+
+    // Tiêu đề trong [from, to); to rỗng là đến hết danh mục
+    static CatalogCursor between(const std::string& from, const std::string& to) {
+        CatalogCursor cursor;
+        cursor.lower = foldText(from);
+        cursor.upper = foldText(to);
+        return cursor;
+    }
+
+    // Tối đa limit id tiếp theo của cursor theo thứ tự tiêu đề, O(log n + limit)
+    std::vector<size_t> next(CatalogCursor& cursor, size_t limit) const {
+        std::vector<size_t> page;
+        if (cursor.finished) {
+            return page;
+        }
+        auto it = cursor.started ? entries.upper_bound({ cursor.lastKey, cursor.lastId })
+            : entries.lower_bound({ cursor.lower, 0 });
+        for (; it != entries.end() && page.size() < limit; ++it) {
+            if (!cursor.upper.empty() && it->first >= cursor.upper) {
+                break;
+            }
+            page.push_back(it->second);
+        }
+        if (!page.empty()) {
+            cursor.lastKey = std::prev(it)->first;
+            cursor.lastId = std::prev(it)->second;
+            cursor.started = true;
+        }
+        cursor.finished = it == entries.end() || (!cursor.upper.empty() && it->first >= cursor.upper);
+        return page;
+    }
+};
+
+// Định dạng file danh mục: dòng đầu là CatalogFormat::HEADER, mỗi dòng sau là một bản ghi
+//   <id>\t<loại>\t<người mượn>\t<thời điểm mượn>\t<tiêu đề>\t<tác giả>\n
+// Người mượn để trống nếu chưa ai mượn, "?" nếu không rõ, còn lại là '@' và username: id người
+// dùng được cấp lại mỗi phiên nên không dùng được để nhận lại người mượn sau khi nạp.
+// Trong username, tiêu đề và tác giả, '\\', tab, '\n', '\r' được ghi thành \\, \t, \n, \r nên dấu phẩy hay
+// ký tự đặc biệt không làm hỏng file. Bản ghi sau của cùng id thay thế bản ghi trước (lần lưu sau
+// chỉ nối thêm tài liệu đã đổi); dòng cuối thiếu '\n' là bản ghi ghi dở và bị bỏ qua.
+// File LEGACY_HEADER (phiên bản 1) ghi id người mượn thay cho username và vẫn đọc được, người mượn thành không rõ.
+struct CatalogFormat {
+    static constexpr char HEADER[] = "LIBCAT 2\n";
+    static constexpr char LEGACY_HEADER[] = "LIBCAT 1\n";
+
+    struct Record {
+        size_t id = 0;
+        char type = 0;
+        bool borrowed = false;
+        std::string holder;           // Username người mượn; rỗng nếu không rõ
+        uint32_t loanedAt = 0;
+        std::string title;
+        std::string author;
+    };
+
+    static void appendEscaped(std::string& out, const std::string& text) {
+        for (char c : text) {
+            switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '\t': out += "\\t"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            default: out += c;
+            }
+        }
+    }
+
+    static bool unescape(std::string_view field, std::string& out) {
+        out.clear();
+        if (field.find('\\') == std::string_view::npos) {
+            out.assign(field.data(), field.size());
+            return true;
+        }
+        out.reserve(field.size());
+        for (size_t i = 0; i < field.size(); ++i) {
+            if (field[i] != '\\') {
+                out += field[i];
+                continue;
+            }
+            if (++i == field.size()) {
+                return false;
+            }
+            switch (field[i]) {
+            case '\\': out += '\\'; break;
+            case 't': out += '\t'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            default: return false;
+            }
+        }
+        return true;
+    }
+
+    // holderNames[id - 1] là username của người dùng có id đó
+    static void appendRecord(std::string& out, size_t id, const Borrowable& item,
+        const std::vector<std::string>& holderNames) {
+        uint32_t holder;
+        uint32_t loanedAt;
+        item.getLoan(holder, loanedAt);
+        out += std::to_string(id);
+        out += '\t';
+        out += item.typeTag();
+        out += '\t';
+        if (holder != 0 && holder <= holderNames.size()) {
+            out += '@';
+            appendEscaped(out, holderNames[holder - 1]);
+        }
+        else if (holder != 0) {
+            out += '?';
+        }
+        out += '\t';
+        out += std::to_string(loanedAt);
+        out += '\t';
+        appendEscaped(out, item.getTitle());
+        out += '\t';
+        appendEscaped(out, item.getAuthor());
+        out += '\n';
+    }
+
+    // line không gồm '\n'; legacy: bản ghi phiên bản 1. false nếu sai định dạng
+    static bool parseRecord(std::string_view line, Record& record, bool legacy) {
+        std::string_view fields[6];
+        for (size_t i = 0; i < 6; ++i) {
+            const size_t tab = i < 5 ? line.find('\t') : line.size();
+            if (tab == std::string_view::npos) {
+                return false;
+            }
+            fields[i] = line.substr(0, tab);
+            line.remove_prefix(i < 5 ? tab + 1 : tab);
+        }
+        if (fields[1].size() != 1 || !parseNumber(fields[0], record.id) || !parseNumber(fields[3], record.loanedAt)) {
+            return false;
+        }
+        record.type = fields[1][0];
+        record.holder.clear();
+        if (legacy) {
+            uint32_t holder = 0;
+            if (!parseNumber(fields[2], holder)) {
+                return false;
+            }
+            record.borrowed = holder != 0;
+        }
+        else if (fields[2].empty() || fields[2] == "?") {
+            record.borrowed = !fields[2].empty();
+        }
+        else if (fields[2][0] != '@' || !unescape(fields[2].substr(1), record.holder)) {
+            return false;
+        }
+        else {
+            record.borrowed = true;
+        }
+        return unescape(fields[4], record.title) && unescape(fields[5], record.author);
+    }
+
+    template <typename T>
+    static bool parseNumber(std::string_view text, T& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size() && !text.empty();
     }
 };
 
 class Library {
 private:
-    std::vector<Borrowable*> items;
-    std::vector<User> users;
+    std::vector<Borrowable*> items; // Id của tài liệu là vị trí trong items
+    std::unordered_map<std::string, User> users;
+    // id người mượn theo username, gồm người dùng đã đăng ký và người mượn trong file đã nạp nhưng
+    // chưa đăng ký lại phiên này; người đăng ký sau nhận đúng id đó nên trả được tài liệu mình mượn
+    std::vector<std::string> holderNames;                 // holderNames[id - 1] là username
+    std::unordered_map<std::string, uint32_t> holderIds;
+    CatalogIndex index;
+    SortedCatalog catalog;
+
+    // Giới hạn đăng nhập sai theo từng username (kể cả username không tồn tại, để không lộ tài khoản
+    // nào có thật): sau MAX_FAILED_LOGINS lần sai liên tiếp, username bị khoá LOCKOUT_BASE, mỗi lần sai
+    // thêm thời gian khoá gấp đôi (tối đa LOCKOUT_MAX). Khi đang khoá, login trả về ngay mà không băm
+    // mật khẩu. Bảng theo dõi có tối đa MAX_THROTTLED_USERNAMES mục; khi đầy thì bỏ mục có ít lần sai
+    // nhất, cùng số lần thì bỏ mục sai lâu nhất. Nhờ vậy rải đăng nhập sai lên nhiều username mới không
+    // xoá được số lần sai của một username: muốn đẩy một mục có k lần sai ra thì mọi mục khác phải có
+    // ít nhất k lần sai và mới hơn.
+    static const uint32_t MAX_FAILED_LOGINS = 5;
+    static const size_t MAX_THROTTLED_USERNAMES = 4096;
+    static constexpr std::chrono::seconds LOCKOUT_BASE{ 1 };
+    static constexpr std::chrono::seconds LOCKOUT_MAX{ 300 };
+
+    struct LoginThrottle {
+        uint32_t failures = 0;
+        std::chrono::steady_clock::time_point lastFailure;
+        std::chrono::steady_clock::time_point lockedUntil;
+    };
+
+    std::unordered_map<std::string, LoginThrottle> throttles;
+
+    LoginThrottle& throttleFor(const std::string& username) {
+        if (throttles.size() >= MAX_THROTTLED_USERNAMES && !throttles.count(username)) {
+            auto weakest = throttles.begin();
+            for (auto it = throttles.begin(); it != throttles.end(); ++it) {
+                const LoginThrottle& t = it->second;
+                const LoginThrottle& w = weakest->second;
+                if (t.failures < w.failures || (t.failures == w.failures && t.lastFailure < w.lastFailure)) {
+                    weakest = it;
+                }
+            }
+            throttles.erase(weakest);
+        }
+        return throttles[username];
+    }
+
+    // File dữ liệu nạp/lưu gần nhất, để lần lưu sau chỉ nối thêm phần thay đổi
+    std::string persistedPath;                // Rỗng: lần lưu sau ghi lại toàn bộ
+    std::vector<uint32_t> persistedVersions;  // version từng tài liệu lúc lưu; size() là số tài liệu đã lưu
+    size_t persistedRecords = 0;              // Số bản ghi trong file
+
+    // Ghi toàn bộ danh mục vào file tạm (bộ đệm 1 MiB), fsync rồi đổi tên
+    void writeCatalog(const std::string& path) {
+        const std::string tempPath = path + ".tmp";
+        FILE* out = std::fopen(tempPath.c_str(), "wb");
+        if (!out) {
+            throw std::runtime_error("Khong the mo file.");
+        }
+        std::setvbuf(out, nullptr, _IOFBF, 1 << 20);
+        std::vector<uint32_t> versions(items.size());
+        std::string record;
+        bool ok = std::fputs(CatalogFormat::HEADER, out) >= 0;
+        for (size_t id = 0; id < items.size() && ok; ++id) {
+            versions[id] = items[id]->getVersion();
+            record.clear();
+            CatalogFormat::appendRecord(record, id, *items[id], holderNames);
+            ok = std::fwrite(record.data(), 1, record.size(), out) == record.size();
+        }
+        ok = syncAndClose(out) && ok;
+        if (!ok) {
+            std::remove(tempPath.c_str());
+        }
+        if (!ok || !replaceFile(tempPath, path)) {
+            throw std::runtime_error("Khong the ghi file.");
+        }
+        persistedPath = path;
+        persistedVersions.swap(versions);
+        persistedRecords = items.size();
+    }
+
+    // Nối bản ghi của các tài liệu changed vào cuối file rồi fsync
+    void appendCatalog(const std::string& path, const std::vector<size_t>& changed) {
+        FILE* out = std::fopen(path.c_str(), "ab");
+        if (!out) {
+            throw std::runtime_error("Khong the mo file.");
+        }
+        std::string records;
+        persistedVersions.resize(items.size());
+        for (size_t id : changed) {
+            persistedVersions[id] = items[id]->getVersion();
+            CatalogFormat::appendRecord(records, id, *items[id], holderNames);
+        }
+        const bool ok = std::fwrite(records.data(), 1, records.size(), out) == records.size();
+        if (!syncAndClose(out) || !ok) {
+            // Đuôi file có thể dở dang: lần lưu sau ghi lại toàn bộ
+            persistedPath.clear();
+            throw std::runtime_error("Khong the ghi file.");
+        }
+        persistedRecords += changed.size();
+    }
+    PasswordCost passwordCost;
+    // Để username không tồn tại cũng tốn một lần băm, với chi phí của số đông tài khoản đang lưu
+    // (đếm trong userCosts) để thời gian trả lời không lộ username có thật sau setPasswordCost
+    User dummyUser{ 0, "", "", PasswordCost() };
+    std::vector<std::pair<PasswordCost, size_t>> userCosts; // Số tài khoản theo chi phí băm
+
+    // id cố định của username trong phiên, cấp mới nếu chưa có; UNKNOWN_HOLDER nếu hết id
+    uint32_t holderId(const std::string& username) {
+        auto found = holderIds.find(username);
+        if (found != holderIds.end()) {
+            return found->second;
+        }
+        if (holderNames.size() + 1 >= Borrowable::UNKNOWN_HOLDER) {
+            return Borrowable::UNKNOWN_HOLDER;
+        }
+        holderNames.push_back(username);
+        const uint32_t id = static_cast<uint32_t>(holderNames.size());
+        holderIds.emplace(username, id);
+        return id;
+    }
+
+    void countUserCost(PasswordCost cost, bool added) {
+        auto entry = std::find_if(userCosts.begin(), userCosts.end(),
+            [&cost](const std::pair<PasswordCost, size_t>& c) { return c.first == cost; });
+        if (entry == userCosts.end()) {
+            entry = userCosts.insert(userCosts.end(), { cost, 0 });
+        }
+        entry->second = added ? entry->second + 1 : entry->second - 1;
+        if (entry->second == 0) {
+            userCosts.erase(entry);
+        }
+    }
+
+    // Chỉ băm lại dummyUser khi chi phí của số đông đổi
+    void updateDummyCost() {
+        auto common = std::max_element(userCosts.begin(), userCosts.end(),
+            [](const std::pair<PasswordCost, size_t>& a, const std::pair<PasswordCost, size_t>& b) {
+                return a.second < b.second;
+            });
+        const PasswordCost dummyCost = common == userCosts.end() ? passwordCost : common->first;
+        if (dummyCost != dummyUser.getCost()) {
+            dummyUser = User(0, "", "", dummyCost);
+        }
+    }
 
 public:
     void addItem(Borrowable* item) {
+        index.add(items.size(), item->getTitle(), item->getAuthor());
+        catalog.add(items.size(), item->getTitle());
         items.push_back(item);
     }
 
-    void addUser(const User& user) {
-        users.push_back(user);
+    size_t itemCount() const {
+        return items.size();
+    }
+
+    const Borrowable* getItem(size_t id) const {
+        return items[id];
     }
 
-    User* login(const std::string& username, const std::string& password) {
-        for (auto& user : users) {
-            if (user.getUsername() == username && user.validatePassword(password)) {
-                return &user;
+    // Chi phí băm cho các tài khoản đăng ký sau đó; tài khoản cũ được băm lại ở lần đăng nhập đúng kế tiếp
+    void setPasswordCost(PasswordCost cost) {
+        passwordCost = cost;
+        if (userCosts.empty()) {
+            dummyUser = User(0, "", "", cost);
+        }
+    }
+
+    PasswordCost getPasswordCost() const {
+        return passwordCost;
+    }
+
+    // Trả về false nếu username đã tồn tại hoặc hết id người dùng
+    bool addUser(const std::string& username, const std::string& password) {
+        if (users.count(username)) {
+            return false;
+        }
+        const uint32_t id = holderId(username);
+        if (id == Borrowable::UNKNOWN_HOLDER) {
+            return false;
+        }
+        users.emplace(username, User(id, username, password, passwordCost));
+        countUserCost(passwordCost, true);
+        updateDummyCost();
+        return true;
+    }
+
+    const User* findUser(const std::string& username) const {
+        auto found = users.find(username);
+        return found == users.end() ? nullptr : &found->second;
+    }
+
+    // Mượn/trả an toàn từ nhiều luồng, miễn là không đồng thời thêm hay sắp xếp tài liệu
+    BorrowResult borrowItem(size_t id, const User& user) {
+        return items[id]->borrow(user.getId());
+    }
+
+    BorrowResult returnItem(size_t id, const User& user) {
+        return items[id]->returnItem(user.getId());
+    }
+
+    // Thủ thư thu hồi tài liệu, kể cả tài liệu có người mượn không rõ (nạp từ dữ liệu cũ)
+    BorrowResult forceReturn(size_t id) {
+        return items[id]->forceReturn();
+    }
+
+    LoginResult login(const std::string& username, const std::string& password, const User*& user) {
+        user = nullptr;
+        const auto now = std::chrono::steady_clock::now();
+        auto throttle = throttles.find(username);
+        if (throttle != throttles.end() && now < throttle->second.lockedUntil) {
+            return LoginResult::RateLimited;
+        }
+        auto found = users.find(username);
+        const bool valid = found != users.end() ? found->second.validatePassword(password)
+            : (dummyUser.validatePassword(password), false);
+        if (valid) {
+            if (throttle != throttles.end()) {
+                throttles.erase(throttle);
+            }
+            if (found->second.getCost() != passwordCost) {
+                countUserCost(found->second.getCost(), false);
+                found->second.rehash(password, passwordCost);
+                countUserCost(passwordCost, true);
+                updateDummyCost();
             }
+            user = &found->second;
+            return LoginResult::Success;
         }
-        throw std::runtime_error("Dang nhap that bai.");
+        LoginThrottle& state = throttle != throttles.end() ? throttle->second : throttleFor(username);
+        state.lastFailure = now;
+        if (++state.failures >= MAX_FAILED_LOGINS) {
+            const uint32_t doublings = std::min<uint32_t>(state.failures - MAX_FAILED_LOGINS, 16);
+            state.lockedUntil = now + std::min<std::chrono::steady_clock::duration>(LOCKOUT_BASE * (1u << doublings), LOCKOUT_MAX);
+        }
+        return LoginResult::InvalidCredentials;
+    }
+
+    // Id tài liệu khớp query (không phân biệt hoa thường và dấu), xếp theo độ liên quan; không in gì
+    std::vector<size_t> search(const std::string& query) const {
+        return index.search(query);
     }
 
     void searchAndDisplay(const std::string& query) const {
         std::cout << "Ket qua tim kiem cho: " << query << std::endl;
-        for (const auto& item : items) {
-            if (item->getTitle().find(query) != std::string::npos ||
-                item->getAuthor().find(query) != std::string::npos) { // Sửa để sử dụng getAuthor()
-                item->displayInfo();
-            }
+        for (size_t id : search(query)) {
+            items[id]->displayInfo();
         }
     }
 
-    void sortItems() {
-        std::sort(items.begin(), items.end(), [](const Borrowable* a, const Borrowable* b) {
-            return a->getTitle() < b->getTitle();
-            });
+    // Trang tiếp theo (tối đa limit id) theo thứ tự tiêu đề; tạo cursor bằng SortedCatalog::all,
+    // withPrefix hoặc between. Danh mục luôn được giữ sắp xếp nên không cần sắp lại.
+    std::vector<size_t> browse(CatalogCursor& cursor, size_t limit) const {
+        return catalog.next(cursor, limit);
     }
 
-    void saveToFile(const std::string& filename) const {
-        std::ofstream file(filename);
-        if (!file) {
-            throw std::runtime_error("Khong the mo file.");
-        }
-        for (const auto& item : items) {
-            file << item->getTitle() << "," << item->getAuthor() << "," << item->getIsBorrowed() << "\n";
+    // Lưu danh mục. Nếu filename là file vừa nạp/lưu thì chỉ nối thêm bản ghi của tài liệu mới hoặc
+    // đã đổi trạng thái (theo version) rồi fsync; khi file có hơn hai lần số tài liệu thì ghi lại toàn bộ
+    // vào file tạm, fsync rồi đổi tên, nên file cũ còn nguyên nếu lưu thất bại giữa chừng.
+    void saveToFile(const std::string& filename) {
+        if (filename == persistedPath) {
+            std::vector<size_t> changed;
+            for (size_t id = 0; id < items.size(); ++id) {
+                if (id >= persistedVersions.size() || items[id]->getVersion() != persistedVersions[id]) {
+                    changed.push_back(id);
+                }
+            }
+            if (changed.empty()) {
+                return;
+            }
+            if (persistedRecords + changed.size() <= 2 * items.size()) {
+                appendCatalog(filename, changed);
+                return;
+            }
         }
-        file.close();
+        writeCatalog(filename);
     }
 
-    void loadFromFile(const std::string& filename) {
-        std::ifstream file(filename);
-        if (!file) {
+    // Nạp danh mục (định dạng CatalogFormat, hoặc CSV "tieu de,tac gia,0|1" cũ) vào cuối danh sách,
+    // không in gì. Trả về số dòng hỏng bị bỏ qua.
+    size_t loadFromFile(const std::string& filename) {
+        MappedFile file;
+        if (!file.open(filename)) {
             throw std::runtime_error("Khong the mo file.");
         }
-        std::string line;
-        while (std::getline(file, line)) {
-            size_t pos1 = line.find(',');
-            size_t pos2 = line.find(',', pos1 + 1);
-            std::string title = line.substr(0, pos1);
-            std::string author = line.substr(pos1 + 1, pos2 - pos1 - 1);
-            bool isBorrowed = (line.substr(pos2 + 1) == "1");
-            Borrowable* item = new Magazine(title, author);
-            if (isBorrowed) {
-                item->borrow();
+        std::string_view text = file.text();
+        const size_t base = items.size();
+        std::vector<CatalogFormat::Record> staged;
+        CatalogFormat::Record record;
+        size_t lines = 0;
+        size_t skipped = 0;
+        bool torn = false;
+        const std::string_view header(CatalogFormat::HEADER);
+        const std::string_view legacyHeader(CatalogFormat::LEGACY_HEADER);
+        const bool current = text.substr(0, header.size()) == header;
+        const bool version1 = !current && text.substr(0, legacyHeader.size()) == legacyHeader;
+        const bool legacy = !current && !version1;
+        if (!legacy) {
+            text.remove_prefix(current ? header.size() : legacyHeader.size());
+        }
+        while (!text.empty()) {
+            const size_t end = text.find('\n');
+            if (end == std::string_view::npos && !legacy) {
+                torn = true;
+                ++skipped;
+                break;
+            }
+            std::string_view line = text.substr(0, end);
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+            ++lines;
+            if (legacy) {
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (line.empty()) {
+                    continue;
+                }
+                // Cờ sau dấu phẩy cuối, tác giả trước nó; phần còn lại là tiêu đề
+                const size_t flag = line.rfind(',');
+                const size_t comma = flag == std::string_view::npos || flag == 0 ? std::string_view::npos : line.rfind(',', flag - 1);
+                if (comma == std::string_view::npos) {
+                    ++skipped;
+                    continue;
+                }
+                record.type = Magazine::TYPE_TAG;
+                record.title.assign(line.data(), comma);
+                record.author.assign(line.data() + comma + 1, flag - comma - 1);
+                record.borrowed = line.substr(flag + 1) == "1";
+                record.holder.clear();
+                record.loanedAt = 0;
+                staged.push_back(std::move(record));
+                continue;
+            }
+            if (!CatalogFormat::parseRecord(line, record, version1) || record.type != Magazine::TYPE_TAG ||
+                record.id > staged.size()) {
+                ++skipped;
+            }
+            else if (record.id == staged.size()) {
+                staged.push_back(std::move(record));
+            }
+            else {
+                staged[record.id] = std::move(record);
+            }
+        }
+
+        items.reserve(base + staged.size());
+        std::vector<std::pair<std::string, uint32_t>> keys;
+        keys.reserve(staged.size());
+        for (CatalogFormat::Record& entry : staged) {
+            const size_t id = items.size();
+            Borrowable* item = new Magazine(std::move(entry.title), std::move(entry.author));
+            // Người mượn được nhận lại theo username, kể cả khi người đó đăng ký sau khi nạp
+            if (entry.borrowed) {
+                item->restoreLoan(entry.holder.empty() ? Borrowable::UNKNOWN_HOLDER : holderId(entry.holder), entry.loanedAt);
+            }
+            index.add(id, item->getTitle(), item->getAuthor());
+            keys.emplace_back(foldText(item->getTitle()), static_cast<uint32_t>(id));
+            items.push_back(item);
+        }
+        catalog.addAll(keys);
+
+        // Chỉ nối thêm vào file khi id trong file trùng id trong bộ nhớ và file không bị ghi dở
+        persistedPath.clear();
+        if (base == 0 && current && !torn) {
+            persistedPath = filename;
+            persistedRecords = lines;
+            persistedVersions.resize(items.size());
+            for (size_t id = 0; id < items.size(); ++id) {
+                persistedVersions[id] = items[id]->getVersion();
             }
-            addItem(item);
         }
-        file.close();
+        return skipped;
     }
 
     ~Library() {
@@ -153,6 +1230,163 @@ public:
     }
 };
 
+// Biên dịch với -DLIBRARY_NO_MAIN để dùng file này như thư viện (xem bench/)
+#ifndef LIBRARY_NO_MAIN
+// Chế độ không tương tác: mỗi dòng một lệnh, mỗi lệnh in đúng một dòng kết quả
+// "<số dòng> OK ..." hoặc "<số dòng> ERR <lý do>". Bỏ qua dòng trống và dòng bắt đầu bằng '#'.
+// Các lệnh:
+//   register <username> <password>    login <username> <password>
+//   search <từ khoá, có thể có khoảng trắng>  (in số kết quả rồi các id theo thứ tự xếp hạng)
+//   borrow <id tài liệu> <username>    return <id tài liệu> <username>
+//   force-return <id tài liệu>         (thủ thư thu hồi tài liệu bất kể người mượn)
+//   browse <số dòng> [tiền tố tiêu đề]  next  (in số id rồi các id theo thứ tự tiêu đề; next lấy trang sau)
+//   save
+// Thông lượng và phân vị độ trễ được ghi ra stats khi kết thúc.
+static void runBatch(Library& library, std::istream& in, std::ostream& out, std::ostream& stats,
+    const std::string& dataPath) {
+    BatchStats batch;
+    CatalogCursor cursor;
+    size_t pageSize = 0;
+    std::string line;
+    size_t lineNumber = 0;
+    const auto started = std::chrono::steady_clock::now();
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+            line.pop_back();
+        }
+        const size_t begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos || line[begin] == '#') {
+            continue;
+        }
+        const auto commandStarted = std::chrono::steady_clock::now();
+        const size_t commandEnd = std::min(line.find_first_of(" \t", begin), line.size());
+        const std::string command = line.substr(begin, commandEnd - begin);
+        const size_t argsBegin = std::min(line.find_first_not_of(" \t", commandEnd), line.size());
+        const std::string args = line.substr(argsBegin);
+        const size_t space = args.find_first_of(" \t");
+        const std::string first = args.substr(0, space);
+        const std::string second = space == std::string::npos ? "" : args.substr(args.find_first_not_of(" \t", space));
+        std::string error;
+        out << lineNumber;
+        if ((command == "register" || command == "login") &&
+            !first.empty() && !second.empty() && second.find_first_of(" \t") == std::string::npos) {
+            if (command == "register") {
+                if (library.addUser(first, second)) {
+                    out << " OK\n";
+                }
+                else {
+                    error = "user-exists";
+                }
+            }
+            else {
+                const User* user = nullptr;
+                switch (library.login(first, second, user)) {
+                case LoginResult::Success:
+                    out << " OK\n";
+                    break;
+                case LoginResult::InvalidCredentials:
+                    error = "login-failed";
+                    break;
+                case LoginResult::RateLimited:
+                    error = "rate-limited";
+                    break;
+                }
+            }
+        }
+        else if ((command == "borrow" || command == "return") &&
+            !first.empty() && !second.empty() && second.find_first_of(" \t") == std::string::npos) {
+            size_t id = 0;
+            auto parsed = std::from_chars(first.data(), first.data() + first.size(), id);
+            const User* user = library.findUser(second);
+            if (parsed.ec != std::errc() || parsed.ptr != first.data() + first.size() || id >= library.itemCount()) {
+                error = "no-item";
+            }
+            else if (!user) {
+                error = "no-user";
+            }
+            else {
+                switch (command == "borrow" ? library.borrowItem(id, *user) : library.returnItem(id, *user)) {
+                case BorrowResult::Success:
+                    out << " OK\n";
+                    break;
+                case BorrowResult::AlreadyBorrowed:
+                    error = "already-borrowed";
+                    break;
+                case BorrowResult::NotBorrowed:
+                    error = "not-borrowed";
+                    break;
+                case BorrowResult::NotHolder:
+                    error = "not-holder";
+                    break;
+                }
+            }
+        }
+        else if (command == "force-return" && !first.empty() && second.empty()) {
+            size_t id = 0;
+            auto parsed = std::from_chars(first.data(), first.data() + first.size(), id);
+            if (parsed.ec != std::errc() || parsed.ptr != first.data() + first.size() || id >= library.itemCount()) {
+                error = "no-item";
+            }
+            else if (library.forceReturn(id) == BorrowResult::Success) {
+                out << " OK\n";
+            }
+            else {
+                error = "not-borrowed";
+            }
+        }
+        else if ((command == "browse" && !first.empty()) || (command == "next" && args.empty())) {
+            if (command == "browse") {
+                auto parsed = std::from_chars(first.data(), first.data() + first.size(), pageSize);
+                if (parsed.ec != std::errc() || parsed.ptr != first.data() + first.size()) {
+                    pageSize = 0;
+                }
+                cursor = second.empty() ? SortedCatalog::all() : SortedCatalog::withPrefix(second);
+            }
+            if (pageSize == 0) {
+                error = "bad-page-size";
+            }
+            else {
+                const std::vector<size_t> page = library.browse(cursor, pageSize);
+                out << " OK " << page.size();
+                for (size_t id : page) {
+                    out << ' ' << id;
+                }
+                out << '\n';
+            }
+        }
+        else if (command == "search") {
+            const std::vector<size_t> found = library.search(args);
+            out << " OK " << found.size();
+            for (size_t id : found) {
+                out << ' ' << id;
+            }
+            out << '\n';
+        }
+        else if (command == "save" && args.empty()) {
+            try {
+                library.saveToFile(dataPath);
+                out << " OK\n";
+            }
+            catch (const std::runtime_error&) {
+                error = "io";
+            }
+        }
+        else {
+            error = "unknown-command";
+        }
+        if (!error.empty()) {
+            out << " ERR " << error << '\n';
+            ++batch.failed;
+        }
+        batch.latencies.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - commandStarted).count()));
+    }
+    out.flush();
+    batch.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    batch.print(stats);
+}
+
 static void displayMenu() {
     std::cout << "==== Menu ====" << std::endl;
     std::cout << "1. Dang ky" << std::endl;
@@ -160,18 +1394,40 @@ static void displayMenu() {
     std::cout << "3. Tim kiem tai lieu" << std::endl;
     std::cout << "4. Luu du lieu" << std::endl;
     std::cout << "5. Thoat" << std::endl;
+    std::cout << "6. Duyet danh muc theo tieu de" << std::endl;
     std::cout << "================" << std::endl;
 }
 
-int main() {
+// Chạy "3 --batch [file]" để đọc lệnh từ file (hoặc stdin nếu không có file)
+int main(int argc, char* argv[]) {
+    const std::string dataPath = "library_data.txt";
     Library library;
     try {
-        library.loadFromFile("library_data.txt");
+        const size_t skipped = library.loadFromFile(dataPath);
+        if (skipped > 0) {
+            std::cout << "Bo qua " << skipped << " dong du lieu hong." << std::endl;
+        }
     }
     catch (const std::runtime_error& e) {
         std::cout << e.what() << std::endl;
     }
 
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        std::ios::sync_with_stdio(false);
+        if (argc > 2) {
+            std::ifstream file(argv[2]);
+            if (!file) {
+                std::cout << "Khong the mo file lenh." << std::endl;
+                return 1;
+            }
+            runBatch(library, file, std::cout, std::cerr, dataPath);
+        }
+        else {
+            runBatch(library, std::cin, std::cout, std::cerr, dataPath);
+        }
+        return 0;
+    }
+
     while (true) {
         displayMenu();
         int choice;
@@ -184,8 +1440,12 @@ int main() {
             std::cin >> username;
             std::cout << "Nhap password: ";
             std::cin >> password;
-            library.addUser(User(username, password));
-            std::cout << "Dang ky thanh cong!" << std::endl;
+            if (library.addUser(username, password)) {
+                std::cout << "Dang ky thanh cong!" << std::endl;
+            }
+            else {
+                std::cout << "Username da ton tai." << std::endl;
+            }
             break;
         }
         case 2: {
@@ -194,13 +1454,18 @@ int main() {
             std::cin >> username;
             std::cout << "Nhap password: ";
             std::cin >> password;
-            try {
-                User* user = library.login(username, password);
+            const User* user = nullptr;
+            switch (library.login(username, password, user)) {
+            case LoginResult::Success:
                 std::cout << "Dang nhap thanh cong!" << std::endl;
                 // Các chức năng khác cho người dùng sau khi đăng nhập
-            }
-            catch (const std::runtime_error& e) {
-                std::cout << e.what() << std::endl;
+                break;
+            case LoginResult::InvalidCredentials:
+                std::cout << "Dang nhap that bai." << std::endl;
+                break;
+            case LoginResult::RateLimited:
+                std::cout << "Dang nhap sai qua nhieu lan, vui long thu lai sau." << std::endl;
+                break;
             }
             break;
         }
@@ -214,7 +1479,7 @@ int main() {
         }
         case 4: {
             try {
-                library.saveToFile("library_data.txt");
+                library.saveToFile(dataPath);
                 std::cout << "Luu du lieu thanh cong!" << std::endl;
             }
             catch (const std::runtime_error& e) {
@@ -225,8 +1490,32 @@ int main() {
         case 5:
             std::cout << "Thoat chuong trinh." << std::endl;
             return 0;
+        case 6: {
+            std::string prefix;
+            std::cout << "Nhap tien to tieu de (bo trong de xem tat ca): ";
+            std::cin.ignore();
+            std::getline(std::cin, prefix);
+            CatalogCursor cursor = prefix.empty() ? SortedCatalog::all() : SortedCatalog::withPrefix(prefix);
+            const size_t pageSize = 10;
+            while (true) {
+                for (size_t id : library.browse(cursor, pageSize)) {
+                    library.getItem(id)->displayInfo();
+                }
+                if (cursor.finished) {
+                    break;
+                }
+                std::string more;
+                std::cout << "Xem tiep? (y/n): ";
+                std::cin >> more;
+                if (more != "y" && more != "Y") {
+                    break;
+                }
+            }
+            break;
+        }
         default:
             std::cout << "Lua chon khong hop le. Vui long chon lai." << std::endl;
         }
     }
 }
+#endif
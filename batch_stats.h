@@ -0,0 +1,36 @@
+#ifndef BATCH_STATS_H
+#define BATCH_STATS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Thống kê của chế độ batch: độ trễ từng lệnh để tính thông lượng và phân vị
+struct BatchStats {
+    std::vector<uint64_t> latencies; // nano giây
+    double seconds = 0;
+    size_t failed = 0;
+
+    // Phân vị theo hạng gần nhất trên mảng đã sắp xếp
+    static uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        const size_t rank = static_cast<size_t>(p / 100 * sorted.size() + 0.999999);
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    void print(std::ostream& out) const {
+        std::vector<uint64_t> sorted(latencies);
+        std::sort(sorted.begin(), sorted.end());
+        out << "lenh: " << sorted.size() << ", loi: " << failed << ", thoi gian: " << seconds << " s, "
+            << (seconds > 0 ? sorted.size() / seconds : 0) << " lenh/s\n";
+        out << "do tre (us): p50 " << percentile(sorted, 50) / 1000.0 << ", p90 " << percentile(sorted, 90) / 1000.0
+            << ", p99 " << percentile(sorted, 99) / 1000.0 << ", p99.9 " << percentile(sorted, 99.9) / 1000.0
+            << ", max " << (sorted.empty() ? 0 : sorted.back()) / 1000.0 << "\n";
+    }
+};
+
+#endif
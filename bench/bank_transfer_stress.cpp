@@ -0,0 +1,77 @@
+// Kiểm tra bảo toàn tiền khi nhiều luồng cùng gọi Bank::transfer: mỗi luồng chuyển ngẫu nhiên
+// giữa các tài khoản, cuối mỗi lượt tổng số dư phải đúng bằng tổng ban đầu và không tài khoản
+// nào âm. In thông lượng theo số luồng.
+//
+// Biên dịch (từ thư mục gốc; thêm -fsanitize=thread để kiểm tra tranh chấp dữ liệu):
+//   g++ -std=c++17 -O2 -pthread -DBANK_NO_MAIN -DBANK_NO_METRICS bench/bank_transfer_stress.cpp -o bank_transfer_stress
+// Chạy: ./bank_transfer_stress [tổng số lần chuyển, mặc định 2000000] [số tài khoản, mặc định 1000]
+//       [số luồng tối đa, mặc định 8]
+#include "../2.cpp"
+
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+struct StressResult {
+    double seconds = 0;
+    uint64_t succeeded = 0;
+    bool conserved = false;
+};
+
+StressResult runStress(unsigned threads, uint64_t transfers, size_t accountCount) {
+    Bank bank;
+    std::vector<std::string> numbers;
+    for (size_t i = 0; i < accountCount; ++i) {
+        numbers.push_back("TK" + std::to_string(100000 + i));
+        bank.addAccount(new SavingsAccount(numbers.back(), "Khach hang", Money::of(1000), Rate()));
+    }
+    const Money initial = bank.totalBalance();
+
+    std::atomic<uint64_t> succeeded{ 0 };
+    const auto started = std::chrono::steady_clock::now();
+    parallelFor(transfers, threads, [&](size_t begin, size_t end, size_t part) {
+        std::mt19937_64 random(part + 1);
+        std::uniform_int_distribution<size_t> pick(0, accountCount - 1);
+        std::uniform_int_distribution<int64_t> amount(1, 200);
+        uint64_t ok = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const size_t from = pick(random);
+            const size_t to = pick(random);
+            if (bank.transfer(numbers[from], numbers[to], Money::of(amount(random))) == OperationResult::Ok) {
+                ++ok;
+            }
+        }
+        succeeded.fetch_add(ok);
+    });
+    StressResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.succeeded = succeeded.load();
+
+    bool nonNegative = true;
+    for (const auto& number : numbers) {
+        nonNegative = nonNegative && bank.findAccount(number)->getBalance() >= Money();
+    }
+    result.conserved = nonNegative && bank.totalBalance() == initial;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint64_t transfers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    const size_t accountCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000;
+    const unsigned maxThreads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 8;
+    std::cout << "So lan chuyen: " << transfers << ", so tai khoan: " << accountCount
+        << ", so nhan CPU: " << std::thread::hardware_concurrency() << std::endl;
+
+    bool conserved = true;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        const StressResult result = runStress(threads, transfers, accountCount);
+        std::cout << threads << " luong: " << result.seconds << " s, " << transfers / result.seconds / 1e6
+            << " M lan chuyen/s, thanh cong " << result.succeeded << ", tong so du "
+            << (result.conserved ? "bao toan" : "BI LECH") << std::endl;
+        conserved = conserved && result.conserved;
+    }
+    return conserved ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// So sánh tổng hợp lương qua vector<Employee *> (mỗi dòng một lời gọi ảo getSalary)
+// với EmployeeColumns (vòng lặp trên các mảng liên tiếp).
+//
+// Biên dịch (từ thư mục gốc):
+//   g++ -std=c++17 -O2 -pthread -DEMPLOYEE_NO_MAIN bench/employee_columns_bench.cpp -o employee_columns_bench
+// Chạy: ./employee_columns_bench [số nhân viên, mặc định 10000000] [số lượt, mặc định 5]
+#include "../1.cpp"
+
+#include <cstdlib>
+
+namespace
+{
+
+// Thời gian nhanh nhất (ms) của passes lần chạy fn
+template <typename Fn>
+double bestMillis(int passes, Fn fn)
+{
+    double best = 0;
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        fn();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        best = pass == 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+void report(const char *name, size_t rows, double pointerMs, double columnMs)
+{
+    std::cout << name << ": con tro " << pointerMs << " ms (" << rows / pointerMs / 1000 << " M dong/s), cot "
+              << columnMs << " ms (" << rows / columnMs / 1000 << " M dong/s), nhanh hon " << pointerMs / columnMs
+              << "x" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    const int passes = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::vector<Employee *> employees;
+    employees.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const int id = static_cast<int>(i);
+        const int age = 20 + static_cast<int>(i % 45);
+        switch (i % 10)
+        {
+        case 0:
+            employees.push_back(new Manager(id, "Manager", age, Money::of(20000000 + i % 1000), static_cast<int>(i % 12)));
+            break;
+        case 1:
+        case 2:
+        case 3:
+            employees.push_back(new HourlyEmployee(id, "Hourly", age, static_cast<int>(i % 200)));
+            break;
+        default:
+            employees.push_back(new Employee(id, "Regular", age, Money::of(8000000 + i % 5000)));
+        }
+    }
+    const EmployeeColumns columns = EmployeeColumns::fromEmployees(employees);
+    std::cout << "So nhan vien: " << n << ", so luot: " << passes << " (lay luot nhanh nhat)" << std::endl;
+
+    bool same = true;
+
+    Money pointerTotal, columnTotal;
+    const double totalPointerMs = bestMillis(passes, [&]
+                                             {
+        pointerTotal = Money();
+        for (const Employee *emp : employees)
+        {
+            pointerTotal += emp->getSalary();
+        } });
+    const double totalColumnMs = bestMillis(passes, [&]
+                                            { columnTotal = columns.totalSalary(); });
+    same = same && pointerTotal == columnTotal;
+    report("Tong luong", n, totalPointerMs, totalColumnMs);
+
+    Money pointerMin, pointerMax, columnMin, columnMax;
+    const double rangePointerMs = bestMillis(passes, [&]
+                                             {
+        pointerMin = pointerMax = employees.empty() ? Money() : employees[0]->getSalary();
+        for (const Employee *emp : employees)
+        {
+            const Money pay = emp->getSalary();
+            pointerMin = std::min(pointerMin, pay);
+            pointerMax = std::max(pointerMax, pay);
+        } });
+    const double rangeColumnMs = bestMillis(passes, [&]
+                                            {
+        columnMin = columns.minSalary();
+        columnMax = columns.maxSalary(); });
+    same = same && pointerMin == columnMin && pointerMax == columnMax;
+    report("Min/max", n, rangePointerMs, rangeColumnMs);
+
+    std::array<Money, 3> pointerByType, columnByType;
+    const double typePointerMs = bestMillis(passes, [&]
+                                            {
+        pointerByType = {};
+        for (const Employee *emp : employees)
+        {
+            pointerByType[static_cast<size_t>(emp->getType())] += emp->getSalary();
+        } });
+    const double typeColumnMs = bestMillis(passes, [&]
+                                           { columnByType = columns.salaryByType(); });
+    same = same && pointerByType == columnByType;
+    report("Tong theo loai", n, typePointerMs, typeColumnMs);
+
+    for (Employee *emp : employees)
+    {
+        delete emp;
+    }
+    if (!same)
+    {
+        std::cout << "Ket qua hai cach tinh khong khop." << std::endl;
+        return 1;
+    }
+    std::cout << "Ket qua hai cach tinh khop nhau. Tong luong: " << columnTotal << std::endl;
+    return 0;
+}
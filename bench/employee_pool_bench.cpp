@@ -0,0 +1,174 @@
+// So sánh new/delete từng nhân viên (cách cũ) với EmployeeArena: số lần cấp phát,
+// thời gian tạo, tốc độ duyệt (gọi getSalary qua vector con trỏ) và thời gian huỷ.
+// Tên dài hơn bộ đệm SSO nên chuỗi tên được cấp phát xen giữa các đối tượng như khi nhập thật.
+// Huỷ EmployeeArena không nhanh hơn delete từng đối tượng: mỗi nhân viên vẫn phải giải phóng chuỗi tên,
+// và pool huỷ theo từng loại nên thứ tự free khác thứ tự cấp phát. Lợi ích của arena nằm ở lúc tạo và duyệt.
+//
+// Biên dịch (từ thư mục gốc):
+//   g++ -std=c++17 -O2 -pthread -DEMPLOYEE_NO_MAIN bench/employee_pool_bench.cpp -o employee_pool_bench
+// Chạy: ./employee_pool_bench [số nhân viên, mặc định 1000000] [số lượt duyệt, mặc định 5]
+#include "../1.cpp"
+
+#include <cstdlib>
+
+namespace
+{
+
+std::atomic<uint64_t> allocations{0};
+
+} // namespace
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+struct Phase
+{
+    double ms;
+    uint64_t allocations;
+};
+
+template <typename Fn>
+Phase measure(Fn fn)
+{
+    const uint64_t before = allocations.load();
+    const auto started = std::chrono::steady_clock::now();
+    fn();
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return {ms, allocations.load() - before};
+}
+
+// Tạo n nhân viên với tỉ lệ 60% thường, 30% theo giờ, 10% quản lý
+template <typename Make>
+void populate(size_t n, Make make)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const int id = static_cast<int>(i);
+        const int age = 20 + static_cast<int>(i % 45);
+        const std::string name = "Nguyễn Văn Nhân viên " + std::to_string(i);
+        switch (i % 10)
+        {
+        case 0:
+            make(EmployeeType::Manager, id, name, age);
+            break;
+        case 1:
+        case 2:
+        case 3:
+            make(EmployeeType::Hourly, id, name, age);
+            break;
+        default:
+            make(EmployeeType::Regular, id, name, age);
+        }
+    }
+}
+
+double bestIterationMillis(const std::vector<Employee *> &employees, int passes, Money &total)
+{
+    double best = 0;
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        const Phase phase = measure([&]
+                                    {
+            total = Money();
+            for (const Employee *emp : employees)
+            {
+                total += emp->getSalary();
+            } });
+        best = pass == 0 ? phase.ms : std::min(best, phase.ms);
+    }
+    return best;
+}
+
+void report(const char *name, size_t n, const Phase &create, double iterateMs, const Phase &destroy)
+{
+    std::cout << name << ": tao " << create.ms << " ms, " << create.allocations << " lan cap phat ("
+              << static_cast<double>(create.allocations) / n << "/nhan vien); duyet " << iterateMs << " ms ("
+              << n / iterateMs / 1000 << " M dong/s); huy " << destroy.ms << " ms" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const int passes = argc > 2 ? std::atoi(argv[2]) : 5;
+    std::cout << "So nhan vien: " << n << ", so luot duyet: " << passes << " (lay luot nhanh nhat)" << std::endl;
+
+    std::vector<Employee *> employees;
+    employees.reserve(n);
+    Money heapTotal, arenaTotal;
+
+    const Phase heapCreate = measure([&]
+                                     { populate(n, [&](EmployeeType type, int id, const std::string &name, int age)
+                                                {
+        switch (type)
+        {
+        case EmployeeType::Manager:
+            employees.push_back(new Manager(id, name, age, Money::of(20000000), 5));
+            break;
+        case EmployeeType::Hourly:
+            employees.push_back(new HourlyEmployee(id, name, age, 160));
+            break;
+        default:
+            employees.push_back(new Employee(id, name, age, Money::of(8000000)));
+        } }); });
+    const double heapIterateMs = bestIterationMillis(employees, passes, heapTotal);
+    const Phase heapDestroy = measure([&]
+                                      {
+        for (Employee *emp : employees)
+        {
+            delete emp;
+        }
+        employees.clear(); });
+    report("new/delete", n, heapCreate, heapIterateMs, heapDestroy);
+
+    auto arena = std::make_unique<EmployeeArena>();
+    const Phase arenaCreate = measure([&]
+                                      { populate(n, [&](EmployeeType type, int id, const std::string &name, int age)
+                                                 {
+        switch (type)
+        {
+        case EmployeeType::Manager:
+            employees.push_back(arena->create<Manager>(id, name, age, Money::of(20000000), 5));
+            break;
+        case EmployeeType::Hourly:
+            employees.push_back(arena->create<HourlyEmployee>(id, name, age, 160));
+            break;
+        default:
+            employees.push_back(arena->create<Employee>(id, name, age, Money::of(8000000)));
+        } }); });
+    const double arenaIterateMs = bestIterationMillis(employees, passes, arenaTotal);
+    const Phase arenaDestroy = measure([&]
+                                       { arena.reset(); });
+    report("EmployeeArena", n, arenaCreate, arenaIterateMs, arenaDestroy);
+
+    // Chuỗi tên cấp phát như nhau ở hai cách; new/delete thêm đúng một lần cho mỗi đối tượng
+    std::cout << "Cap phat cho doi tuong: new/delete " << n << ", EmployeeArena "
+              << arenaCreate.allocations + n - heapCreate.allocations << std::endl;
+    if (heapTotal != arenaTotal)
+    {
+        std::cout << "Tong luong hai cach khong khop." << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Nhiều quầy (luồng) cùng mượn/trả ngẫu nhiên trên một nhóm nhỏ tài liệu, kể cả trả tài liệu
+// người khác đang mượn. Mỗi quầy ghi lại tài liệu nó mượn thành công; cuối mỗi lượt, người mượn
+// của từng tài liệu phải khớp đúng ghi chép đó và số lần mượn trừ số lần trả phải bằng số tài liệu
+// đang được mượn (không mất cập nhật). In thông lượng theo số luồng.
+//
+// Biên dịch (từ thư mục gốc; thêm -fsanitize=thread để kiểm tra tranh chấp dữ liệu):
+//   g++ -std=c++17 -O2 -pthread -DLIBRARY_NO_MAIN bench/library_checkout_bench.cpp -o library_checkout_bench
+// Chạy: ./library_checkout_bench [tổng số thao tác, mặc định 4000000] [số tài liệu, mặc định 64]
+//       [số luồng tối đa, mặc định 8]
+#include "../3.cpp"
+
+#include "../parallel_for.h"
+
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+struct CheckoutRun {
+    double seconds = 0;
+    uint64_t borrowed = 0;
+    uint64_t returned = 0;
+    bool consistent = false;
+};
+
+CheckoutRun runCheckout(unsigned threads, uint64_t operations, size_t itemCount) {
+    Library library;
+    for (size_t i = 0; i < itemCount; ++i) {
+        library.addItem(new Magazine("Tap chi " + std::to_string(i), "Tac gia"));
+    }
+    std::vector<const User*> desks;
+    for (unsigned t = 0; t < threads; ++t) {
+        const std::string username = "quay" + std::to_string(t);
+        library.addUser(username, "matkhau");
+        desks.push_back(library.findUser(username));
+    }
+
+    // held[t][i]: quầy t đang giữ tài liệu i theo ghi chép của chính nó
+    std::vector<std::vector<char>> held(threads, std::vector<char>(itemCount, 0));
+    std::atomic<uint64_t> borrowed{ 0 }, returned{ 0 };
+    const auto started = std::chrono::steady_clock::now();
+    parallelFor(threads, threads, [&](size_t begin, size_t end, size_t) {
+        for (size_t t = begin; t < end; ++t) {
+            std::mt19937_64 random(t + 1);
+            std::uniform_int_distribution<size_t> pick(0, itemCount - 1);
+            uint64_t borrows = 0, returns = 0;
+            for (uint64_t op = 0; op < operations / threads; ++op) {
+                const size_t id = pick(random);
+                if (random() & 1) {
+                    if (library.borrowItem(id, *desks[t]) == BorrowResult::Success) {
+                        held[t][id] = 1;
+                        ++borrows;
+                    }
+                }
+                else if (library.returnItem(id, *desks[t]) == BorrowResult::Success) {
+                    held[t][id] = 0;
+                    ++returns;
+                }
+            }
+            borrowed.fetch_add(borrows);
+            returned.fetch_add(returns);
+        }
+    });
+    CheckoutRun run;
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    run.borrowed = borrowed.load();
+    run.returned = returned.load();
+
+    uint64_t onLoan = 0;
+    bool matches = true;
+    for (size_t i = 0; i < itemCount; ++i) {
+        const uint32_t holder = library.getItem(i)->getHolder();
+        onLoan += holder != 0;
+        for (unsigned t = 0; t < threads; ++t) {
+            matches = matches && (held[t][i] != 0) == (holder == desks[t]->getId());
+        }
+    }
+    run.consistent = matches && run.borrowed - run.returned == onLoan;
+    return run;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint64_t operations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    const size_t itemCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    const unsigned maxThreads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 8;
+    std::cout << "So thao tac: " << operations << ", so tai lieu: " << itemCount
+        << ", so nhan CPU: " << std::thread::hardware_concurrency() << std::endl;
+
+    bool consistent = true;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        const CheckoutRun run = runCheckout(threads, operations, itemCount);
+        std::cout << threads << " luong: " << run.seconds << " s, " << operations / run.seconds / 1e6
+            << " M thao tac/s, muon " << run.borrowed << ", tra " << run.returned << ", trang thai "
+            << (run.consistent ? "khop" : "BI LECH") << std::endl;
+        consistent = consistent && run.consistent;
+    }
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+// Thông lượng ShardedBank theo số phân mảnh (1 đến 32) với hai kiểu tải: chọn tài khoản đều
+// và tải lệch (một nửa số lần chuyển đi vào hoặc ra từ một tài khoản nóng). Mỗi lượt kiểm tra
+// tổng số dư không đổi sau khi drain(). Mỗi luồng gửi giữ tối đa IN_FLIGHT yêu cầu chưa xong;
+// nếu gửi hết một lần thì pha cộng tiền liên phân mảnh phải xếp sau mọi lệnh trừ tiền đang chờ,
+// tài khoản cạn tiền và phần lớn lệnh chuyển thất bại.
+//
+// Biên dịch (từ thư mục gốc):
+//   g++ -std=c++17 -O2 -pthread -DBANK_NO_MAIN -DBANK_NO_METRICS bench/sharded_bank_bench.cpp -o sharded_bank_bench
+// Chạy: ./sharded_bank_bench [tổng số lần chuyển, mặc định 1000000] [số tài khoản, mặc định 10000]
+//       [số luồng gửi, mặc định 4]
+#include "../2.cpp"
+
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+const uint32_t IN_FLIGHT = 1024;
+
+struct ShardRun {
+    double seconds = 0;
+    uint64_t succeeded = 0;
+    bool conserved = false;
+};
+
+ShardRun runShards(size_t shardCount, bool skewed, uint64_t transfers, size_t accountCount, unsigned producers) {
+    ShardedBank bank(shardCount);
+    std::vector<std::string> numbers;
+    for (size_t i = 0; i < accountCount; ++i) {
+        numbers.push_back("TK" + std::to_string(100000 + i));
+        bank.addAccount(new SavingsAccount(numbers.back(), "Khach hang", Money::of(1000), Rate()));
+    }
+    const Money initial = bank.totalBalance();
+
+    std::atomic<uint64_t> succeeded{ 0 };
+    const auto started = std::chrono::steady_clock::now();
+    parallelFor(transfers, producers, [&](size_t begin, size_t end, size_t part) {
+        std::mt19937_64 random(part + 1);
+        std::uniform_int_distribution<size_t> pick(0, accountCount - 1);
+        std::uniform_int_distribution<int64_t> amount(1, 200);
+        Operation op;
+        op.type = OperationType::Transfer;
+        std::atomic<uint32_t> inFlight{ 0 };
+        for (size_t i = begin; i < end; ++i) {
+            size_t from = pick(random);
+            size_t to = pick(random);
+            if (skewed && (random() & 1)) {
+                // Tài khoản 0 là tài khoản nóng, lúc là nguồn lúc là đích
+                (random() & 1 ? from : to) = 0;
+            }
+            op.account = numbers[from];
+            op.toAccount = numbers[to];
+            op.amount = Money::of(amount(random));
+            while (inFlight.load() >= IN_FLIGHT) {
+                std::this_thread::yield();
+            }
+            ++inFlight;
+            bank.submit(op, [&succeeded, &inFlight](OperationResult result) {
+                if (result == OperationResult::Ok) {
+                    succeeded.fetch_add(1, std::memory_order_relaxed);
+                }
+                --inFlight;
+            });
+        }
+        while (inFlight.load() > 0) {
+            std::this_thread::yield();
+        }
+    });
+    bank.drain();
+    ShardRun run;
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    run.succeeded = succeeded.load();
+    run.conserved = bank.totalBalance() == initial;
+    return run;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint64_t transfers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const size_t accountCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000;
+    const unsigned producers = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 4;
+    std::cout << "So lan chuyen: " << transfers << ", so tai khoan: " << accountCount << ", luong gui: " << producers
+        << ", so nhan CPU: " << std::thread::hardware_concurrency() << std::endl;
+
+    bool conserved = true;
+    for (bool skewed : { false, true }) {
+        for (size_t shards = 1; shards <= 32; shards *= 2) {
+            const ShardRun run = runShards(shards, skewed, transfers, accountCount, producers);
+            std::cout << (skewed ? "lech" : "deu") << ", " << shards << " phan manh: " << run.seconds << " s, "
+                << transfers / run.seconds / 1e6 << " M lan chuyen/s, thanh cong " << run.succeeded << ", tong so du "
+                << (run.conserved ? "bao toan" : "BI LECH") << std::endl;
+            conserved = conserved && run.conserved;
+        }
+    }
+    return conserved ? 0 : 1;
+}
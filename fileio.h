@@ -0,0 +1,146 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Đọc cả file một lần: mmap trên POSIX, đọc theo khối trên Windows. File rỗng mở được, size() = 0.
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::string buffer;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        if (info.st_size == 0) {
+            ::close(fd);
+            return true;
+        }
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+        bytes = static_cast<const char*>(mapped);
+        length = info.st_size;
+#else
+        FILE* in = std::fopen(filename.c_str(), "rb");
+        if (!in) {
+            return false;
+        }
+        char chunk[1 << 16];
+        size_t got;
+        while ((got = std::fread(chunk, 1, sizeof chunk, in)) > 0) {
+            buffer.append(chunk, got);
+        }
+        std::fclose(in);
+        bytes = buffer.data();
+        length = buffer.size();
+#endif
+        return true;
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (bytes) {
+            munmap(const_cast<char*>(bytes), length);
+        }
+#else
+        buffer.clear();
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    std::string_view text() const {
+        return std::string_view(bytes, length);
+    }
+
+    ~MappedFile() {
+        close();
+    }
+};
+
+// fflush rồi fsync; false nếu một trong hai lỗi
+inline bool syncFile(FILE* f) {
+    if (std::fflush(f) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+// Đẩy dữ liệu xuống đĩa rồi đóng file; false nếu ghi, fsync hoặc đóng lỗi
+inline bool syncAndClose(FILE* out) {
+    const bool synced = syncFile(out);
+    return std::fclose(out) == 0 && synced;
+}
+
+// Thay path bằng tempPath (đã ghi đủ và fsync) rồi fsync thư mục để việc đổi tên cũng bền vững.
+// Lỗi thì xoá tempPath và trả về false; path cũ còn nguyên.
+inline bool replaceFile(const std::string& tempPath, const std::string& path) {
+#ifdef _WIN32
+    // rename trên Windows không ghi đè file đã có
+    if (std::remove(path.c_str()) != 0 && errno != ENOENT) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+#endif
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+#ifndef _WIN32
+    const size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    int dirFd = ::open(directory.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        ::close(dirFd);
+    }
+#endif
+    return true;
+}
+
+#endif
@@ -0,0 +1,402 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Chia a / b (b > 0) và làm tròn nửa về số chẵn (banker's rounding)
+template <typename Wide>
+inline Wide divideRoundHalfEven(Wide a, Wide b) {
+    Wide q = a / b;
+    Wide r = a % b;
+    if (r < 0) {
+        r = -r;
+    }
+    const Wide twice = r * 2;
+    if (twice > b || (twice == b && q % 2 != 0)) {
+        q += a < 0 ? -1 : 1;
+    }
+    return q;
+}
+
+// Cộng, trừ, nhân int64_t có kiểm tra tràn, viết bằng phép so sánh để không phụ thuộc
+// __builtin_*_overflow của GCC/Clang: false (out không đổi) nếu kết quả không vừa int64_t
+inline bool checkedAdd(int64_t a, int64_t b, int64_t& out) {
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) {
+        return false;
+    }
+    out = a + b;
+    return true;
+}
+
+inline bool checkedSubtract(int64_t a, int64_t b, int64_t& out) {
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) {
+        return false;
+    }
+    out = a - b;
+    return true;
+}
+
+inline bool checkedMultiply(int64_t a, int64_t b, int64_t& out) {
+    if (a > 0 ? (b > 0 ? a > INT64_MAX / b : b < INT64_MIN / a)
+              : (b > 0 ? a < INT64_MIN / b : a != 0 && b < INT64_MAX / a)) {
+        return false;
+    }
+    out = a * b;
+    return true;
+}
+
+// Làm tròn value tới số nguyên gần nhất (nửa thì ra xa 0); false nếu NaN hoặc ngoài khoảng int64_t
+inline bool roundToInt64(double value, int64_t& out) {
+    const double rounded = value + (value < 0 ? -0.5 : 0.5);
+    if (!(rounded > -9223372036854775808.0 && rounded < 9223372036854775808.0)) {
+        return false;
+    }
+    out = static_cast<int64_t>(rounded);
+    return true;
+}
+
+// Tỉ lệ cố định (lãi suất, phần trăm) lưu theo phần tỉ: 0.05 = 50'000'000
+class Rate {
+private:
+    int64_t ppb;
+
+    constexpr explicit Rate(int64_t partsPerBillion) : ppb(partsPerBillion) {}
+
+public:
+    static const int64_t SCALE = 1000000000;
+
+    constexpr Rate() : ppb(0) {}
+
+    static constexpr Rate fromPartsPerBillion(int64_t partsPerBillion) {
+        return Rate(partsPerBillion);
+    }
+
+    // false nếu value là NaN hoặc quá lớn
+    static bool fromDouble(double value, Rate& out) {
+        int64_t parts;
+        if (!roundToInt64(value * SCALE, parts)) {
+            return false;
+        }
+        out = Rate(parts);
+        return true;
+    }
+
+    // Số phần trăm chẵn: percent(5) = 0.05
+    static constexpr Rate percent(int64_t whole) {
+        return Rate(whole * (SCALE / 100));
+    }
+
+    int64_t partsPerBillion() const {
+        return ppb;
+    }
+
+    double toDouble() const {
+        return static_cast<double>(ppb) / SCALE;
+    }
+
+    // Đọc số thập phân như "0.05"; quá 9 chữ số lẻ thì làm tròn nửa chẵn
+    static bool parse(std::string_view text, Rate& out);
+
+    bool operator==(Rate other) const { return ppb == other.ppb; }
+    bool operator!=(Rate other) const { return ppb != other.ppb; }
+};
+
+// Tiền tệ dạng số nguyên cố định: lưu số phần trăm đồng (1/100) trong int64_t.
+// Cộng trừ là chính xác; nhân với tỉ lệ làm tròn nửa về số chẵn, nên tổng hợp
+// hàng loạt cho cùng kết quả dù cộng theo thứ tự nào hay trên bao nhiêu luồng.
+// Dữ liệu từ ngoài (parse, fromDouble, fromUnits có kiểm tra) bị giới hạn trong ±MAX_UNITS.
+// add/subtract/multiply/applyRate có kiểm tra trả về false khi tràn; số dư tài khoản chỉ được đổi
+// qua các phép này. Các toán tử không bao giờ tràn (hành vi không xác định) mà bão hoà tại ±INT64_MAX
+// mà không báo lỗi, nên chỉ dùng khi biết kết quả nằm trong khoảng hoặc cho tổng hợp báo cáo.
+class Money {
+private:
+    int64_t value;
+
+    constexpr explicit Money(int64_t units) : value(units) {}
+
+    static int64_t saturate(bool negative) {
+        return negative ? -INT64_MAX : INT64_MAX;
+    }
+
+    // Đọc phần nguyên và phần lẻ thập phân; digits chữ số lẻ được giữ, phần dư làm tròn nửa chẵn
+    static bool parseFixed(std::string_view text, int digits, int64_t scale, int64_t& out) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+            text.remove_suffix(1);
+        }
+        bool negative = false;
+        if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+            negative = text.front() == '-';
+            text.remove_prefix(1);
+        }
+        const size_t point = text.find('.');
+        std::string_view whole = text.substr(0, point);
+        std::string_view fraction = point == std::string_view::npos ? std::string_view() : text.substr(point + 1);
+        if (whole.empty() && fraction.empty()) {
+            return false;
+        }
+        int64_t integer = 0;
+        if (!whole.empty()) {
+            if (whole.front() == '-') {
+                return false;
+            }
+            auto result = std::from_chars(whole.data(), whole.data() + whole.size(), integer);
+            if (result.ec != std::errc() || result.ptr != whole.data() + whole.size()) {
+                return false;
+            }
+        }
+        int64_t fractional = 0;
+        for (int i = 0; i < digits; ++i) {
+            char c = i < static_cast<int>(fraction.size()) ? fraction[i] : '0';
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            fractional = fractional * 10 + (c - '0');
+        }
+        // Làm tròn phần dư: > nửa thì lên, đúng nửa thì về số chẵn
+        if (static_cast<int>(fraction.size()) > digits) {
+            std::string_view rest = fraction.substr(digits);
+            for (char c : rest) {
+                if (c < '0' || c > '9') {
+                    return false;
+                }
+            }
+            const bool aboveHalf = rest[0] > '5' || (rest[0] == '5' && rest.find_first_not_of('0', 1) != std::string_view::npos);
+            const bool exactlyHalf = rest[0] == '5' && !aboveHalf;
+            if (aboveHalf || (exactlyHalf && fractional % 2 != 0)) {
+                ++fractional;
+            }
+        }
+        // integer * scale + fractional phải vừa int64_t (kể cả khi làm tròn làm fractional bằng scale)
+        if (integer > (INT64_MAX - fractional) / scale) {
+            return false;
+        }
+        int64_t total = integer * scale + fractional;
+        out = negative ? -total : total;
+        return true;
+    }
+
+    friend bool Rate::parse(std::string_view text, Rate& out);
+
+public:
+    static const int64_t SCALE = 100;
+    // 10^15 đồng: đủ cho mọi số tiền thật, và cộng 92 số như vậy vẫn không tràn int64_t
+    static const int64_t MAX_UNITS = 100000000000000000;
+
+    static constexpr bool inRange(int64_t units) {
+        return units >= -MAX_UNITS && units <= MAX_UNITS;
+    }
+
+    constexpr Money() : value(0) {}
+
+    static constexpr Money fromUnits(int64_t units) {
+        return Money(units);
+    }
+
+    // Cho dữ liệu đọc từ file: false nếu units ngoài ±MAX_UNITS
+    static bool fromUnits(int64_t units, Money& out) {
+        if (!inRange(units)) {
+            return false;
+        }
+        out = Money(units);
+        return true;
+    }
+
+    // Số tiền chẵn đồng
+    static constexpr Money of(int64_t whole) {
+        return Money(whole * SCALE);
+    }
+
+    // Chỉ dùng khi nhận dữ liệu cũ dạng double; làm tròn tới đơn vị gần nhất.
+    // false nếu amount là NaN hoặc ngoài ±MAX_UNITS.
+    static bool fromDouble(double amount, Money& out) {
+        int64_t units;
+        if (!roundToInt64(amount * SCALE, units) || !inRange(units)) {
+            return false;
+        }
+        out = Money(units);
+        return true;
+    }
+
+    // Đọc "123", "123.4", "-123.45"; nhiều hơn 2 chữ số lẻ thì làm tròn nửa chẵn.
+    // false nếu không phải số hoặc ngoài ±MAX_UNITS.
+    static bool parse(std::string_view text, Money& out) {
+        int64_t units;
+        if (!parseFixed(text, 2, SCALE, units) || !inRange(units)) {
+            return false;
+        }
+        out = Money(units);
+        return true;
+    }
+
+    int64_t units() const {
+        return value;
+    }
+
+    double toDouble() const {
+        return static_cast<double>(value) / SCALE;
+    }
+
+    // Các phép có kiểm tra: false (out không đổi) nếu kết quả không vừa int64_t
+    static bool add(Money a, Money b, Money& out) {
+        int64_t sum;
+        if (!checkedAdd(a.value, b.value, sum)) {
+            return false;
+        }
+        out = Money(sum);
+        return true;
+    }
+
+    static bool subtract(Money a, Money b, Money& out) {
+        int64_t difference;
+        if (!checkedSubtract(a.value, b.value, difference)) {
+            return false;
+        }
+        out = Money(difference);
+        return true;
+    }
+
+    static bool multiply(Money a, int64_t factor, Money& out) {
+        int64_t product;
+        if (!checkedMultiply(a.value, factor, product)) {
+            return false;
+        }
+        out = Money(product);
+        return true;
+    }
+
+    // Tiền lãi hoặc phần trăm: value * rate, làm tròn nửa về số chẵn
+    bool applyRate(Rate rate, Money& out) const {
+#if defined(__SIZEOF_INT128__)
+        const __int128 product = divideRoundHalfEven<__int128>(static_cast<__int128>(value) * rate.partsPerBillion(),
+            Rate::SCALE);
+        if (product < INT64_MIN || product > INT64_MAX) {
+            return false;
+        }
+        out = Money(static_cast<int64_t>(product));
+        return true;
+#else
+        // Không có __int128: cũng báo tràn khi phép nhân trung gian rest * rate tràn (tỉ lệ rất lớn)
+        const int64_t whole = value / Rate::SCALE;
+        const int64_t rest = value % Rate::SCALE;
+        int64_t wholePart, restPart, sum;
+        if (!checkedMultiply(whole, rate.partsPerBillion(), wholePart) ||
+            !checkedMultiply(rest, rate.partsPerBillion(), restPart) ||
+            !checkedAdd(wholePart, divideRoundHalfEven<int64_t>(restPart, Rate::SCALE), sum)) {
+            return false;
+        }
+        out = Money(sum);
+        return true;
+#endif
+    }
+
+    // Bão hoà tại ±INT64_MAX khi tràn
+    Money applyRate(Rate rate) const {
+        Money result;
+        if (!applyRate(rate, result)) {
+            const bool negative = (value < 0) != (rate.partsPerBillion() < 0);
+            return Money(saturate(negative));
+        }
+        return result;
+    }
+
+    // Ghi ra dạng "1234" hoặc "1234.50" (bỏ phần lẻ khi bằng 0); trả về con trỏ sau ký tự cuối
+    char* format(char* first, char* last) const {
+        // Lấy trị tuyệt đối dạng không dấu để -INT64_MIN không tràn
+        const uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        const uint64_t whole = magnitude / SCALE;
+        const uint64_t cents = magnitude % SCALE;
+        if (value < 0) {
+            if (first == last) {
+                return first;
+            }
+            *first++ = '-';
+        }
+        first = std::to_chars(first, last, whole).ptr;
+        if (cents != 0 && last - first >= 3) {
+            *first++ = '.';
+            *first++ = static_cast<char>('0' + cents / 10);
+            *first++ = static_cast<char>('0' + cents % 10);
+        }
+        return first;
+    }
+
+    std::string toString() const {
+        char text[32];
+        return std::string(text, format(text, text + sizeof text));
+    }
+
+    Money operator+(Money other) const {
+        Money sum;
+        return add(*this, other, sum) ? sum : Money(saturate(other.value < 0));
+    }
+
+    Money operator-(Money other) const {
+        Money difference;
+        return subtract(*this, other, difference) ? difference : Money(saturate(other.value > 0));
+    }
+
+    Money operator-() const {
+        return Money(value == INT64_MIN ? INT64_MAX : -value);
+    }
+
+    Money operator*(int64_t factor) const {
+        Money product;
+        return multiply(*this, factor, product) ? product : Money(saturate((value < 0) != (factor < 0)));
+    }
+
+    // Chia đều (ví dụ lương trung bình), làm tròn nửa về số chẵn
+    Money operator/(int64_t divisor) const {
+        return Money(divideRoundHalfEven<int64_t>(value, divisor));
+    }
+    Money& operator+=(Money other) { return *this = *this + other; }
+    Money& operator-=(Money other) { return *this = *this - other; }
+
+    bool operator==(Money other) const { return value == other.value; }
+    bool operator!=(Money other) const { return value != other.value; }
+    bool operator<(Money other) const { return value < other.value; }
+    bool operator<=(Money other) const { return value <= other.value; }
+    bool operator>(Money other) const { return value > other.value; }
+    bool operator>=(Money other) const { return value >= other.value; }
+};
+
+inline bool Rate::parse(std::string_view text, Rate& out) {
+    int64_t parts;
+    if (!Money::parseFixed(text, 9, SCALE, parts)) {
+        return false;
+    }
+    out = Rate(parts);
+    return true;
+}
+
+inline std::ostream& operator<<(std::ostream& stream, Money amount) {
+    char text[32];
+    return stream.write(text, amount.format(text, text + sizeof text) - text);
+}
+
+// Đọc một từ rồi phân tích; đặt failbit nếu không phải số hợp lệ
+inline std::istream& operator>>(std::istream& stream, Money& amount) {
+    std::string text;
+    if (stream >> text && !Money::parse(text, amount)) {
+        stream.setstate(std::ios::failbit);
+    }
+    return stream;
+}
+
+inline std::istream& operator>>(std::istream& stream, Rate& rate) {
+    std::string text;
+    if (stream >> text && !Rate::parse(text, rate)) {
+        stream.setstate(std::ios::failbit);
+    }
+    return stream;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Chia [0, n) thành các đoạn liên tiếp, mỗi luồng xử lý một đoạn: fn(begin, end, part)
+template <typename Fn>
+void parallelFor(size_t n, unsigned threads, Fn fn) {
+    const size_t parts = std::max<size_t>(1, std::min<size_t>(threads, n));
+    std::vector<std::thread> workers;
+    for (size_t part = 1; part < parts; ++part) {
+        workers.emplace_back(fn, n * part / parts, n * (part + 1) / parts, part);
+    }
+    fn(0, n / parts, 0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+#endif
@@ -0,0 +1,99 @@
+// Người mượn phải còn trả được tài liệu sau khi lưu rồi nạp lại danh mục, dù id người dùng được
+// cấp lại theo thứ tự đăng ký mỗi phiên: mượn, saveToFile, nạp vào thư viện mới (đăng ký người dùng
+// theo thứ tự khác, trước hoặc sau khi nạp), rồi trả. Người khác vẫn không trả được; tài liệu từ dữ liệu
+// cũ không rõ người mượn thì chỉ forceReturn thu hồi được.
+//
+// Biên dịch và chạy (từ thư mục gốc):
+//   g++ -std=c++17 -O2 -pthread -DLIBRARY_NO_MAIN tests/library_loan_reload_test.cpp -o library_loan_reload_test
+//   ./library_loan_reload_test
+#include "../3.cpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cout << "THAT BAI: " << what << std::endl;
+        ++failures;
+    }
+}
+
+const char* const DATA_PATH = "library_loan_reload_test.txt";
+
+void addItems(Library& library) {
+    library.addItem(new Magazine("Tap chi A", "Tac gia A"));
+    library.addItem(new Magazine("Tap chi B", "Tac gia B"));
+    library.addItem(new Magazine("Tap chi C", "Tac gia C"));
+}
+
+void testReturnAfterReload(bool registerBeforeLoad) {
+    {
+        Library library;
+        library.setPasswordCost({ 1, 0 });
+        addItems(library);
+        library.addUser("an", "1");
+        library.addUser("binh", "2");
+        check(library.borrowItem(0, *library.findUser("an")) == BorrowResult::Success, "an muon tai lieu 0");
+        check(library.borrowItem(1, *library.findUser("binh")) == BorrowResult::Success, "binh muon tai lieu 1");
+        library.saveToFile(DATA_PATH);
+    }
+
+    Library library;
+    library.setPasswordCost({ 1, 0 });
+    // Đăng ký theo thứ tự ngược lại để id của mỗi người khác với phiên đã lưu
+    if (registerBeforeLoad) {
+        library.addUser("binh", "2");
+        library.addUser("an", "1");
+    }
+    check(library.loadFromFile(DATA_PATH) == 0, "nap lai khong bo dong nao");
+    if (!registerBeforeLoad) {
+        library.addUser("binh", "2");
+        library.addUser("an", "1");
+    }
+    const User& an = *library.findUser("an");
+    const User& binh = *library.findUser("binh");
+    check(library.getItem(0)->getIsBorrowed() && library.getItem(1)->getIsBorrowed(), "tai lieu van dang duoc muon");
+    check(library.returnItem(0, binh) == BorrowResult::NotHolder, "nguoi khac khong tra duoc");
+    check(library.returnItem(0, an) == BorrowResult::Success, "an tra duoc tai lieu minh muon");
+    check(library.returnItem(1, binh) == BorrowResult::Success, "binh tra duoc tai lieu minh muon");
+    check(library.returnItem(2, an) == BorrowResult::NotBorrowed, "tai lieu chua muon");
+
+    // Lần lưu sau chỉ nối thêm bản ghi đã đổi; nạp lại thấy đã trả hết
+    check(library.borrowItem(2, an) == BorrowResult::Success, "an muon tai lieu 2");
+    library.saveToFile(DATA_PATH);
+    Library reloaded;
+    reloaded.setPasswordCost({ 1, 0 });
+    reloaded.loadFromFile(DATA_PATH);
+    reloaded.addUser("an", "1");
+    check(!reloaded.getItem(0)->getIsBorrowed() && !reloaded.getItem(1)->getIsBorrowed(), "da tra sau khi nap lai");
+    check(reloaded.returnItem(2, *reloaded.findUser("an")) == BorrowResult::Success, "an tra sau lan nap thu hai");
+}
+
+void testLegacyUnknownHolder() {
+    {
+        std::ofstream legacy(DATA_PATH, std::ios::binary);
+        legacy << "Tap chi cu,Tac gia,1\nTap chi moi,Tac gia,0\n";
+    }
+    Library library;
+    library.setPasswordCost({ 1, 0 });
+    library.loadFromFile(DATA_PATH);
+    library.addUser("an", "1");
+    check(library.getItem(0)->getHolder() == Borrowable::UNKNOWN_HOLDER, "du lieu cu: nguoi muon khong ro");
+    check(library.returnItem(0, *library.findUser("an")) == BorrowResult::NotHolder, "du lieu cu: nguoi dung khong tra duoc");
+    check(library.forceReturn(0) == BorrowResult::Success, "thu thu thu hoi duoc");
+    check(library.forceReturn(1) == BorrowResult::NotBorrowed, "thu hoi tai lieu chua muon");
+    check(library.borrowItem(0, *library.findUser("an")) == BorrowResult::Success, "muon lai sau khi thu hoi");
+}
+
+} // namespace
+
+int main() {
+    testReturnAfterReload(true);
+    testReturnAfterReload(false);
+    testLegacyUnknownHolder();
+    std::remove(DATA_PATH);
+    std::remove((std::string(DATA_PATH) + ".tmp").c_str());
+    std::cout << (failures == 0 ? "OK" : "CO LOI") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Giá trị đã biết cho Money/Rate: phân tích chuỗi (kể cả làm tròn nửa chẵn ở chữ số lẻ thứ ba),
+// divideRoundHalfEven, applyRate và các phép có kiểm tra tràn.
+//
+// Biên dịch và chạy (từ thư mục gốc); thêm -U__SIZEOF_INT128__ để kiểm tra cả nhánh applyRate
+// không dùng __int128:
+//   g++ -std=c++17 -O2 tests/money_test.cpp -o money_test
+//   ./money_test
+#include "../money.h"
+
+#include <iostream>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cout << "THAT BAI: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// Số đơn vị (1/100 đồng) khi parse thành công, hoặc -1 khi parse thất bại
+int64_t parsedUnits(const char* text) {
+    Money amount;
+    return Money::parse(text, amount) ? amount.units() : -1;
+}
+
+int64_t parsedParts(const char* text) {
+    Rate rate;
+    return Rate::parse(text, rate) ? rate.partsPerBillion() : -1;
+}
+
+int64_t interestUnits(int64_t units, Rate rate) {
+    Money interest;
+    return Money::fromUnits(units).applyRate(rate, interest) ? interest.units() : INT64_MIN;
+}
+
+void testParse() {
+    check(parsedUnits("123") == 12300, "parse 123");
+    check(parsedUnits("123.4") == 12340, "parse 123.4");
+    check(parsedUnits("-123.45") == -12345, "parse -123.45");
+    check(parsedUnits("+1") == 100, "parse +1");
+    check(parsedUnits(" 7.5\t") == 750, "parse co khoang trang");
+    check(parsedUnits(".5") == 50, "parse .5");
+    check(parsedUnits("0.125") == 12, "0.125: dung nua, lam tron ve so chan");
+    check(parsedUnits("0.135") == 14, "0.135: dung nua, lam tron ve so chan");
+    check(parsedUnits("0.1251") == 13, "0.1251: tren nua");
+    check(parsedUnits("0.1249") == 12, "0.1249: duoi nua");
+    check(parsedUnits("-0.125") == -12, "-0.125: dung nua, lam tron ve so chan");
+    check(parsedUnits("1000000000000000") == Money::MAX_UNITS, "parse MAX_UNITS");
+    const char* const invalid[] = { "", ".", "-", "abc", "1e5", "1.2.3", "--1", "1,5", "0.1x", "1000000000000000.01",
+        "9223372036854775807" };
+    for (const char* text : invalid) {
+        check(parsedUnits(text) == -1, text);
+    }
+
+    check(parsedParts("0.05") == 50000000, "rate 0.05");
+    check(parsedParts("0.0000000005") == 0, "rate dung nua, lam tron ve so chan (0)");
+    check(parsedParts("0.0000000015") == 2, "rate dung nua, lam tron ve so chan (2)");
+}
+
+void testRounding() {
+    check(divideRoundHalfEven<int64_t>(5, 2) == 2, "5/2");
+    check(divideRoundHalfEven<int64_t>(7, 2) == 4, "7/2");
+    check(divideRoundHalfEven<int64_t>(-5, 2) == -2, "-5/2");
+    check(divideRoundHalfEven<int64_t>(-7, 2) == -4, "-7/2");
+    check(divideRoundHalfEven<int64_t>(10, 4) == 2, "10/4");
+    check(divideRoundHalfEven<int64_t>(11, 4) == 3, "11/4");
+    check(divideRoundHalfEven<int64_t>(9, 4) == 2, "9/4");
+    check(Money::fromUnits(101) / 2 == Money::fromUnits(50), "Money 1.01 / 2");
+    check(Money::fromUnits(103) / 2 == Money::fromUnits(52), "Money 1.03 / 2");
+}
+
+void testApplyRate() {
+    check(interestUnits(10000, Rate::percent(5)) == 500, "100.00 * 5%");
+    check(interestUnits(12345, Rate::fromPartsPerBillion(5000000)) == 62, "123.45 * 0.5% = 0.61725");
+    check(interestUnits(25, Rate::percent(10)) == 2, "0.25 * 10%: dung nua");
+    check(interestUnits(35, Rate::percent(10)) == 4, "0.35 * 10%: dung nua");
+    check(interestUnits(-35, Rate::percent(10)) == -4, "-0.35 * 10%: dung nua");
+    check(interestUnits(Money::MAX_UNITS, Rate::percent(50)) == Money::MAX_UNITS / 2, "MAX_UNITS * 50%");
+    check(interestUnits(INT64_MAX, Rate::percent(200)) == INT64_MIN, "tran khi nhan ty le");
+    check(Money::fromUnits(INT64_MAX).applyRate(Rate::percent(200)) == Money::fromUnits(INT64_MAX), "applyRate bao hoa");
+}
+
+void testChecked() {
+    Money out = Money::fromUnits(7);
+    check(!Money::add(Money::fromUnits(INT64_MAX), Money::fromUnits(1), out) && out.units() == 7, "add tran, out khong doi");
+    check(!Money::add(Money::fromUnits(INT64_MIN), Money::fromUnits(-1), out), "add tran am");
+    check(Money::add(Money::fromUnits(INT64_MAX), Money::fromUnits(-1), out) && out.units() == INT64_MAX - 1, "add gan bien");
+    check(!Money::subtract(Money::fromUnits(INT64_MIN), Money::fromUnits(1), out), "subtract tran");
+    check(!Money::subtract(Money::fromUnits(0), Money::fromUnits(INT64_MIN), out), "subtract INT64_MIN");
+    check(Money::subtract(Money::fromUnits(-1), Money::fromUnits(INT64_MAX), out) && out.units() == INT64_MIN, "subtract toi INT64_MIN");
+    check(!Money::multiply(Money::fromUnits(INT64_MIN), -1, out), "INT64_MIN * -1");
+    check(!Money::multiply(Money::fromUnits(-1), INT64_MIN, out), "-1 * INT64_MIN");
+    check(!Money::multiply(Money::fromUnits(INT64_MAX / 2 + 1), 2, out), "multiply tran");
+    check(Money::multiply(Money::fromUnits(INT64_MIN / 2), 2, out) && out.units() == INT64_MIN, "multiply toi INT64_MIN");
+    check(Money::multiply(Money::fromUnits(-3), -4, out) && out.units() == 12, "-3 * -4");
+    check(Money::multiply(Money::fromUnits(0), INT64_MIN, out) && out.units() == 0, "0 * INT64_MIN");
+    check(Money::fromUnits(INT64_MAX) + Money::fromUnits(1) == Money::fromUnits(INT64_MAX), "toan tu + bao hoa");
+}
+
+void testFormat() {
+    check(Money::fromUnits(12340).toString() == "123.40", "format 123.40");
+    check(Money::fromUnits(12300).toString() == "123", "format 123");
+    check(Money::fromUnits(-5).toString() == "-0.05", "format -0.05");
+    check(Money::fromUnits(INT64_MIN).toString() == "-92233720368547758.08", "format INT64_MIN");
+}
+
+} // namespace
+
+int main() {
+    testParse();
+    testRounding();
+    testApplyRate();
+    testChecked();
+    testFormat();
+    std::cout << (failures == 0 ? "OK" : "CO LOI") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
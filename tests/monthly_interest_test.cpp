@@ -0,0 +1,74 @@
+// Tài khoản có kỳ hạn chỉ được tính lãi đúng term lần chạy tính lãi hằng tháng: chạy qua mốc hết
+// kỳ hạn thì số dư đứng yên, còn tài khoản tiết kiệm vẫn được tính tiếp. Số tháng đã tính lãi phải
+// còn nguyên sau khi khôi phục từ log, để lần chạy sau khôi phục không tính thêm lãi cho khoản đã hết hạn.
+//
+// Biên dịch và chạy (từ thư mục gốc):
+//   g++ -std=c++17 -O2 -pthread -DBANK_NO_MAIN tests/monthly_interest_test.cpp -o monthly_interest_test
+//   ./monthly_interest_test
+#include "../2.cpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cout << "THAT BAI: " << what << std::endl;
+        ++failures;
+    }
+}
+
+const char* const SNAPSHOT_PATH = "monthly_interest_test.snapshot";
+const char* const LOG_PATH = "monthly_interest_test.wal";
+
+void removeFiles() {
+    std::remove(SNAPSHOT_PATH);
+    std::remove(LOG_PATH);
+}
+
+Money balanceOf(const Bank& bank, const char* number) {
+    return bank.findAccount(number)->getBalance();
+}
+
+void testTermBoundary() {
+    removeFiles();
+    // 1%/tháng trên 100.00: 101.00, 102.01, 103.0301 -> 103.03, rồi hết kỳ hạn 3 tháng
+    const Money expectedFixed[] = { Money::fromUnits(10100), Money::fromUnits(10201), Money::fromUnits(10303),
+        Money::fromUnits(10303), Money::fromUnits(10303) };
+    const Money expectedSavings[] = { Money::fromUnits(10100), Money::fromUnits(10201), Money::fromUnits(10303),
+        Money::fromUnits(10406), Money::fromUnits(10510) };
+    {
+        Bank bank;
+        check(bank.recover(SNAPSHOT_PATH, LOG_PATH), "mo log");
+        bank.addAccount(new FixedDepositAccount("FD", "An", Money::of(100), Rate::percent(1), 3));
+        bank.addAccount(new SavingsAccount("SV", "Binh", Money::of(100), Rate::percent(1)));
+        for (int month = 0; month < 5; ++month) {
+            Money total;
+            check(bank.accrueMonthlyInterest(total), "tinh lai thang " + std::to_string(month + 1));
+            check(balanceOf(bank, "FD") == expectedFixed[month],
+                "co ky han sau thang " + std::to_string(month + 1) + ": " + balanceOf(bank, "FD").toString());
+            check(balanceOf(bank, "SV") == expectedSavings[month],
+                "tiet kiem sau thang " + std::to_string(month + 1) + ": " + balanceOf(bank, "SV").toString());
+        }
+    }
+
+    // Phát lại log: cùng số dư, và lần chạy tiếp theo vẫn không tính lãi cho khoản đã hết hạn
+    Bank recovered;
+    check(recovered.recover(SNAPSHOT_PATH, LOG_PATH), "khoi phuc tu log");
+    check(balanceOf(recovered, "FD") == expectedFixed[4], "co ky han sau khoi phuc");
+    check(balanceOf(recovered, "SV") == expectedSavings[4], "tiet kiem sau khoi phuc");
+    check(recovered.checkpoint(SNAPSHOT_PATH), "checkpoint");
+    Money total;
+    check(recovered.accrueMonthlyInterest(total), "tinh lai sau khoi phuc");
+    check(balanceOf(recovered, "FD") == expectedFixed[4], "co ky han het han van dung yen sau checkpoint");
+    check(total == balanceOf(recovered, "SV") - expectedSavings[4], "tong lai chi gom tai khoan tiet kiem");
+}
+
+} // namespace
+
+int main() {
+    testTermBoundary();
+    removeFiles();
+    std::cout << (failures == 0 ? "OK" : "CO LOI") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+// Giá trị đã biết cho Sha256 (vector của FIPS 180-4 / NIST) và PasswordHasher. Giá trị Balloon với
+// muối cố định 00 01 .. 0f được tính độc lập bằng hashlib của Python theo đúng thuật toán trong
+// PasswordHasher::hash, nên đổi cách băm (kể cả thứ tự byte của bộ đếm) sẽ làm test này thất bại.
+//
+// Biên dịch và chạy (từ thư mục gốc):
+//   g++ -std=c++17 -O2 -pthread -DLIBRARY_NO_MAIN tests/password_hash_test.cpp -o password_hash_test
+//   ./password_hash_test
+#include "../3.cpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cout << "THAT BAI: " << what << std::endl;
+        ++failures;
+    }
+}
+
+std::string hex(const Sha256::Digest& digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (uint8_t b : digest) {
+        out += digits[b >> 4];
+        out += digits[b & 0xF];
+    }
+    return out;
+}
+
+std::string sha256(const std::string& text) {
+    return hex(Sha256().update(text.data(), text.size()).finish());
+}
+
+void testSha256() {
+    check(sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", "sha256 chuoi rong");
+    check(sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", "sha256 abc");
+    check(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", "sha256 448 bit");
+    check(sha256("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu") ==
+        "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1", "sha256 896 bit");
+    check(sha256(std::string(1000000, 'a')) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+        "sha256 1 trieu 'a'");
+
+    // Cắt dữ liệu thành nhiều lần update ở mọi vị trí quanh biên khối phải cho cùng kết quả
+    const std::string text(130, 'x');
+    const std::string whole = sha256(text);
+    for (size_t split = 0; split <= text.size(); ++split) {
+        Sha256 hasher;
+        hasher.update(text.data(), split).update(text.data() + split, text.size() - split);
+        check(hex(hasher.finish()) == whole, "sha256 tach tai " + std::to_string(split));
+    }
+}
+
+void testBalloon() {
+    PasswordHasher::Salt salt;
+    for (size_t i = 0; i < salt.size(); ++i) {
+        salt[i] = static_cast<uint8_t>(i);
+    }
+    check(hex(PasswordHasher::hash("password", salt, { 16, 2 })) ==
+        "bf72412595f2a38a9efb3d39a8c5c24a83b9a9f61f5cba46b58e58707139644a", "balloon 16 khoi, 2 luot");
+    check(hex(PasswordHasher::hash("password", salt, PasswordCost())) ==
+        "2ab3ccb04e831d215481b7c074cfacf1305e9f8607d0d0fb4ee94288dc400376", "balloon chi phi mac dinh");
+
+    const Sha256::Digest base = PasswordHasher::hash("password", salt, { 16, 2 });
+    PasswordHasher::Salt otherSalt = salt;
+    otherSalt[0] ^= 1;
+    check(!PasswordHasher::equal(base, PasswordHasher::hash("passwore", salt, { 16, 2 })), "balloon doi mat khau");
+    check(!PasswordHasher::equal(base, PasswordHasher::hash("password", otherSalt, { 16, 2 })), "balloon doi muoi");
+    check(!PasswordHasher::equal(base, PasswordHasher::hash("password", salt, { 16, 3 })), "balloon doi so luot");
+    check(!PasswordHasher::equal(base, PasswordHasher::hash("password", salt, { 17, 2 })), "balloon doi so khoi");
+
+    const User user(1, "an", "mat khau", { 16, 1 });
+    check(user.validatePassword("mat khau"), "User chap nhan mat khau dung");
+    check(!user.validatePassword("mat khau "), "User tu choi mat khau sai");
+}
+
+} // namespace
+
+int main() {
+    testSha256();
+    testBalloon();
+    std::cout << (failures == 0 ? "OK" : "CO LOI") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Lỗi ghi log phải là vĩnh viễn: giới hạn kích thước file (RLIMIT_FSIZE) làm một lần ghi thất bại,
+// sau đó bỏ giới hạn. Không LSN nào từ chỗ lỗi trở đi được báo là bền, file log chỉ chứa các bản ghi
+// đã được xác nhận, và chỉ reset() (sau checkpoint) mới cho ghi tiếp.
+//
+// Biên dịch và chạy (từ thư mục gốc, chỉ POSIX):
+//   g++ -std=c++17 -O2 -pthread -DBANK_NO_MAIN tests/transaction_log_failure_test.cpp -o transaction_log_failure_test
+//   ./transaction_log_failure_test
+#include "../2.cpp"
+
+#include <csignal>
+#include <sys/resource.h>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cout << "THAT BAI: " << what << std::endl;
+        ++failures;
+    }
+}
+
+LogRecord depositRecord(int i) {
+    LogRecord record;
+    record.op = LogOp::Deposit;
+    record.account = "TK" + std::to_string(i);
+    record.amount = Money::of(i);
+    return record;
+}
+
+bool setFileSizeLimit(rlim_t bytes) {
+    rlimit limit;
+    if (getrlimit(RLIMIT_FSIZE, &limit) != 0) {
+        return false;
+    }
+    limit.rlim_cur = std::min(bytes, limit.rlim_max);
+    return setrlimit(RLIMIT_FSIZE, &limit) == 0;
+}
+
+} // namespace
+
+int main() {
+    std::signal(SIGXFSZ, SIG_IGN); // Để write trả về EFBIG thay vì kết thúc tiến trình
+    const std::string path = "transaction_log_failure_test.wal";
+    std::remove(path.c_str());
+
+    TransactionLog log;
+    check(log.open(path, 1), "mo log");
+
+    // Ghi từng bản ghi một cho tới khi chạm giới hạn 4 KiB
+    check(setFileSizeLimit(4096), "dat RLIMIT_FSIZE");
+    uint64_t lastAcknowledged = 0;
+    uint64_t failedLsn = 0;
+    for (int i = 0; i < 1000 && failedLsn == 0; ++i) {
+        const uint64_t lsn = log.append(depositRecord(i));
+        if (log.waitDurable(lsn)) {
+            lastAcknowledged = lsn;
+        }
+        else {
+            failedLsn = lsn;
+        }
+    }
+    check(failedLsn != 0, "gioi han kich thuoc lam mot lan ghi that bai");
+    check(setFileSizeLimit(RLIM_INFINITY), "bo RLIMIT_FSIZE");
+
+    // Đĩa đã ghi được trở lại nhưng log vẫn phải báo lỗi cho mọi LSN sau chỗ lỗi
+    // Cho luồng commit thời gian xử lý các bản ghi mới trước khi hỏi, để không trả về sớm nhờ cờ lỗi
+    std::vector<uint64_t> later;
+    for (int i = 0; i < 100; ++i) {
+        later.push_back(log.append(depositRecord(i)));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    bool anyAcknowledged = false;
+    for (uint64_t lsn : later) {
+        anyAcknowledged = log.waitDurable(lsn) || anyAcknowledged;
+    }
+    check(!log.waitDurable(failedLsn), "LSN loi van bao loi");
+    check(!anyAcknowledged, "khong LSN nao sau loi duoc xac nhan");
+
+    uint64_t lastRead = 0;
+    TransactionLog::read(path, [&lastRead](const LogRecord& record) { lastRead = record.lsn; });
+    check(lastRead == lastAcknowledged, "file log dung o ban ghi cuoi da xac nhan");
+
+    // Sau checkpoint, reset() tạo log mới và cho ghi tiếp
+    check(log.reset(), "reset sau checkpoint");
+    const uint64_t afterReset = log.append(depositRecord(0));
+    check(log.waitDurable(afterReset), "ghi duoc sau reset");
+    size_t records = 0;
+    TransactionLog::read(path, [&records](const LogRecord&) { ++records; });
+    check(records == 1, "log moi chi chua ban ghi sau reset");
+
+    log.close();
+    std::remove(path.c_str());
+    std::cout << "Ban ghi cuoi da xac nhan: " << lastAcknowledged << ", LSN loi: " << failedLsn << std::endl;
+    std::cout << (failures == 0 ? "OK" : "CO LOI") << std::endl;
+    return failures == 0 ? 0 : 1;
+}